@@ -0,0 +1,27 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "../src/bridge.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static inline uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,144 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define ITERATIONS 10
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static const struct
+{
+    STR_t name;
+
+    size_t size;
+
+} PAYLOADS[] = {
+    {"1k x 1k x 16", 1024 * 1024 * 2},
+    {"4k x 4k x 16", 4096 * 4096 * 2},
+    {"6k x 4k x 16", 6248 * 4176 * 2},
+};
+
+static STR_t LEVELS[] = {"scalar", "SSSE3", "AVX2"};
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void fill_payload(uint8_t *buff, size_t size)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* 16-BIT SKY-LIKE PIXELS: SMOOTH BACKGROUND + NOISE                                                              */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint32_t seed = 0x12345678;
+
+    for(size_t i = 0; i + 1 < size; i += 2)
+    {
+        seed = seed * 1664525U + 1013904223U;
+
+        uint16_t pixel = (uint16_t) (1000 + (i / 2) % 512 + (seed >> 24));
+
+        buff[i + 0] = (uint8_t) (pixel >> 8);
+        buff[i + 1] = (uint8_t) (pixel >> 0);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int main(void)
+{
+    int result = 0;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    int max_level = nyx_base64_set_level(-1);
+
+    printf("%-14s %-7s %12s %12s\n", "payload", "kernel", "enc MB/s", "dec MB/s");
+
+    for(size_t i = 0; i < sizeof(PAYLOADS) / sizeof(PAYLOADS[0]); i++)
+    {
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        size_t size = PAYLOADS[i].size;
+
+        uint8_t *raw = malloc(size);
+        str_t enc = malloc(NYX_BASE64_ENCODED_SIZE(size));
+        uint8_t *dec = malloc(NYX_BASE64_DECODED_SIZE(NYX_BASE64_ENCODED_SIZE(size)));
+
+        fill_payload(raw, size);
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        for(int level = NYX_BASE64_SCALAR; level <= max_level; level++)
+        {
+            nyx_base64_set_level(level);
+
+            /*--------------------------------------------------------------------------------------------------------*/
+
+            size_t enc_len = 0;
+
+            uint64_t t0 = bench_now_ns();
+
+            for(int j = 0; j < ITERATIONS; j++)
+            {
+                enc_len = nyx_base64_encode(enc, size, raw);
+            }
+
+            uint64_t t1 = bench_now_ns();
+
+            /*--------------------------------------------------------------------------------------------------------*/
+
+            size_t dec_len = 0;
+
+            uint64_t t2 = bench_now_ns();
+
+            for(int j = 0; j < ITERATIONS; j++)
+            {
+                dec_len = nyx_base64_decode(dec, enc_len, enc);
+            }
+
+            uint64_t t3 = bench_now_ns();
+
+            /*--------------------------------------------------------------------------------------------------------*/
+
+            if(dec_len != size || memcmp(raw, dec, size) != 0)
+            {
+                fprintf(stderr, "Round trip mismatch: %s, %s\n", PAYLOADS[i].name, LEVELS[level]);
+
+                result = 1;
+            }
+
+            /*--------------------------------------------------------------------------------------------------------*/
+
+            double mb = (double) size * ITERATIONS / 1.0e6;
+
+            printf("%-14s %-7s %12.1f %12.1f\n", PAYLOADS[i].name, LEVELS[level], mb / ((double) (t1 - t0) / 1.0e9), mb / ((double) (t3 - t2) / 1.0e9));
+
+            /*--------------------------------------------------------------------------------------------------------*/
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        free(raw);
+        free(enc);
+        free(dec);
+
+        /*------------------------------------------------------------------------------------------------------------*/
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return result;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,32 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "../src/external/mongoose.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int nyx_curr_log_level = MG_LL_NONE; /* NOSONAR */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void __attribute__((format(printf, 1, 2))) nyx_log(const char *fmt, ...)
+{
+    if(nyx_curr_log_level <= MG_LL_ERROR)
+    {
+        va_list ap;
+        va_start(ap, fmt);
+        vfprintf(stderr, fmt, ap);
+        va_end(ap);
+
+        fputc('\n', stderr);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,638 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include "../src/external/mongoose.h"
+
+#include "bench.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define INDI_URL "tcp://127.0.0.1:17624"
+
+#define MQTT_URL "mqtt://127.0.0.1:11883"
+
+#define MAX_BACKLOG (16UL * 1024UL * 1024UL)
+
+#define DRAIN_MS 1000UL
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* OPTIONS                                                                                                            */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static unsigned long m_duration = 10;
+
+static unsigned long m_set_rate = 1000;
+
+static unsigned long m_blob_rate = 0;
+
+static unsigned long m_blob_size = 1024UL * 1024UL;
+
+static unsigned long m_cmd_rate = 100;
+
+static unsigned long m_devices = 4;
+
+static unsigned long m_mix[4] = {70, 10, 10, 10}; /* NUMBER, SWITCH, TEXT, MESSAGE */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* TRAFFIC CLASSES                                                                                                    */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define CLASS_SET 0
+#define CLASS_BLOB 1
+#define CLASS_CMD 2
+#define CLASSES 3
+
+static STR_t CLASS_NAMES[CLASSES] = {"indi>mqtt set", "indi>mqtt blob", "mqtt>indi cmd"};
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    uint64_t sent;
+
+    uint64_t received;
+
+    uint64_t bytes;
+
+    nyx_hist_t latency;
+
+} class_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* STATE OF THE FAKE INDISERVER / BROKER THREAD                                                                       */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static class_t m_classes[CLASSES];
+
+static struct mg_connection *m_indi = NULL;
+
+static struct mg_connection *m_subscriber = NULL;
+
+static str_t m_blob_b64 = NULL;
+
+static size_t m_blob_b64_len = 0;
+
+static volatile uint64_t m_start = 0;
+
+static uint64_t m_throttled = 0;
+
+static volatile bool m_done = false;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static uint64_t parse_timestamp(struct mg_str s)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* THE SEND TIME, IN MICROSECONDS, TRAVELS IN THE TIMESTAMP ATTRIBUTE: timestamp="..." OR "@timestamp":"..."      */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    for(size_t i = 0; i + 11 < s.len; i++)
+    {
+        if(memcmp(s.buf + i, "timestamp", 9) == 0)
+        {
+            size_t j = i + 9;
+
+            while(j < s.len && (s.buf[j] == '"' || s.buf[j] == '=' || s.buf[j] == ':'))
+            {
+                j++;
+            }
+
+            uint64_t result = 0;
+
+            while(j < s.len && s.buf[j] >= '0' && s.buf[j] <= '9')
+            {
+                result = 10 * result + (uint64_t) (s.buf[j++] - '0');
+            }
+
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void record(int cls, uint64_t timestamp, size_t len)
+{
+    if(timestamp >= m_start && m_start > 0)
+    {
+        m_classes[cls].received++;
+
+        m_classes[cls].bytes += len;
+
+        nyx_hist_record(&m_classes[cls].latency, nyx_metrics_now() - timestamp);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* FAKE INDISERVER                                                                                                    */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void indi_define(struct mg_connection *connection)
+{
+    for(unsigned long i = 0; i < m_devices; i++)
+    {
+        mg_printf(connection,
+            "<defNumberVector device=\"Load %lu\" name=\"LOAD_NUMBER\" state=\"Idle\" perm=\"rw\" timeout=\"60\" timestamp=\"0\">"
+            "<defNumber name=\"VALUE\" format=\"%%g\" min=\"0\" max=\"0\" step=\"0\">0</defNumber></defNumberVector>"
+            "<defSwitchVector device=\"Load %lu\" name=\"LOAD_SWITCH\" state=\"Idle\" perm=\"rw\" rule=\"OneOfMany\" timeout=\"60\" timestamp=\"0\">"
+            "<defSwitch name=\"ON\">On</defSwitch><defSwitch name=\"OFF\">Off</defSwitch></defSwitchVector>"
+            "<defTextVector device=\"Load %lu\" name=\"LOAD_TEXT\" state=\"Idle\" perm=\"ro\" timeout=\"60\" timestamp=\"0\">"
+            "<defText name=\"STATUS\">idle</defText></defTextVector>"
+            "<defBLOBVector device=\"Load %lu\" name=\"LOAD_BLOB\" state=\"Idle\" perm=\"ro\" timeout=\"60\" timestamp=\"0\">"
+            "<defBLOB name=\"IMAGE\"/></defBLOBVector>",
+            i, i, i, i
+        );
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void indi_send_set(struct mg_connection *connection, uint64_t seq)
+{
+    unsigned long total = m_mix[0] + m_mix[1] + m_mix[2] + m_mix[3];
+
+    unsigned long slot = total > 0 ? (unsigned long) (seq % total) : 0;
+
+    unsigned long device = (unsigned long) (seq % m_devices);
+
+    uint64_t now = nyx_metrics_now();
+
+    /**/ if(slot < m_mix[0]) {
+        mg_printf(connection, "<setNumberVector device=\"Load %lu\" name=\"LOAD_NUMBER\" state=\"Ok\" timeout=\"60\" timestamp=\"%llu\"><oneNumber name=\"VALUE\">%llu</oneNumber></setNumberVector>", device, (unsigned long long) now, (unsigned long long) seq);
+    }
+    else if(slot < m_mix[0] + m_mix[1]) {
+        mg_printf(connection, "<setSwitchVector device=\"Load %lu\" name=\"LOAD_SWITCH\" state=\"Ok\" timeout=\"60\" timestamp=\"%llu\"><oneSwitch name=\"ON\">%s</oneSwitch><oneSwitch name=\"OFF\">%s</oneSwitch></setSwitchVector>", device, (unsigned long long) now, (seq & 1) ? "On" : "Off", (seq & 1) ? "Off" : "On");
+    }
+    else if(slot < m_mix[0] + m_mix[1] + m_mix[2]) {
+        mg_printf(connection, "<setTextVector device=\"Load %lu\" name=\"LOAD_TEXT\" state=\"Ok\" timeout=\"60\" timestamp=\"%llu\"><oneText name=\"STATUS\">frame %llu &amp; counting</oneText></setTextVector>", device, (unsigned long long) now, (unsigned long long) seq);
+    }
+    else {
+        mg_printf(connection, "<message device=\"Load %lu\" timestamp=\"%llu\" message=\"[INFO] Load message %llu\"/>", device, (unsigned long long) now, (unsigned long long) seq);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void indi_send_blob(struct mg_connection *connection, uint64_t seq)
+{
+    mg_printf(connection, "<setBLOBVector device=\"Load %lu\" name=\"LOAD_BLOB\" state=\"Ok\" timeout=\"60\" timestamp=\"%llu\"><oneBLOB name=\"IMAGE\" size=\"%lu\" format=\".fits\">", (unsigned long) (seq % m_devices), (unsigned long long) nyx_metrics_now(), m_blob_size);
+
+    mg_send(connection, m_blob_b64, m_blob_b64_len);
+
+    mg_printf(connection, "</oneBLOB></setBLOBVector>");
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void indi_handler(struct mg_connection *connection, int ev, __attribute__ ((unused)) void *ev_data)
+{
+    /**/ if(ev == MG_EV_ACCEPT)
+    {
+        m_indi = connection;
+    }
+    else if(ev == MG_EV_CLOSE)
+    {
+        if(m_indi == connection)
+        {
+            m_indi = NULL;
+        }
+    }
+    else if(ev == MG_EV_READ)
+    {
+        /*------------------------------------------------------------------------------------------------------------*/
+        /* ONLY COMPLETE START TAGS ARE SCANNED: THE STREAM IS CONSUMED UP TO ITS LAST '>'                            */
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        STR_t buff = (STR_t) connection->recv.buf;
+
+        STR_t last = memrchr(buff, '>', connection->recv.len);
+
+        if(last == NULL)
+        {
+            return;
+        }
+
+        size_t len = (size_t) (last - buff) + 1;
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        if(memmem(buff, len, "<getProperties", 14) != NULL)
+        {
+            indi_define(connection);
+        }
+
+        for(STR_t p = buff; (p = memmem(p, len - (size_t) (p - buff), "<new", 4)) != NULL; p += 4)
+        {
+            record(CLASS_CMD, parse_timestamp(mg_str_n(p, len - (size_t) (p - buff))), 0);
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        mg_iobuf_del(&connection->recv, 0, len);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* FAKE MQTT BROKER                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void broker_subscribe(struct mg_connection *connection, const struct mg_mqtt_message *message)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    STR_t p = message->dgram.buf + 1;
+
+    while((*p++ & 0x80) != 0);
+
+    p += 2; /* PACKET IDENTIFIER */
+
+    STR_t end = message->dgram.buf + message->dgram.len;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint8_t granted[32];
+
+    size_t topic_cnt = 0;
+
+    while(p + 2 < end && topic_cnt < sizeof(granted))
+    {
+        size_t topic_len = ((size_t) (uint8_t) p[0] << 8) | (size_t) (uint8_t) p[1];
+
+        if(mg_match(mg_str_n(p + 2, topic_len), mg_str("nyx/cmd/json"), NULL))
+        {
+            m_subscriber = connection;
+        }
+
+        p += 2 + topic_len + 1;
+
+        granted[topic_cnt++] = 0;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint16_t id = mg_ntohs(message->id);
+
+    mg_mqtt_send_header(connection, MQTT_CMD_SUBACK, 0, (uint32_t) (sizeof(id) + topic_cnt));
+
+    mg_send(connection, &id, sizeof(id));
+
+    mg_send(connection, granted, topic_cnt);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void broker_handler(struct mg_connection *connection, int ev, void *ev_data)
+{
+    /**/ if(ev == MG_EV_CLOSE)
+    {
+        if(m_subscriber == connection)
+        {
+            m_subscriber = NULL;
+        }
+    }
+    else if(ev == MG_EV_MQTT_CMD)
+    {
+        const struct mg_mqtt_message *message = ev_data;
+
+        /**/ if(message->cmd == MQTT_CMD_CONNECT)
+        {
+            mg_mqtt_send_header(connection, MQTT_CMD_CONNACK, 0, 2);
+
+            mg_send(connection, "\x00\x00", 2);
+        }
+        else if(message->cmd == MQTT_CMD_SUBSCRIBE)
+        {
+            broker_subscribe(connection, message);
+        }
+        else if(message->cmd == MQTT_CMD_PINGREQ)
+        {
+            mg_mqtt_pong(connection);
+        }
+    }
+    else if(ev == MG_EV_MQTT_MSG)
+    {
+        const struct mg_mqtt_message *message = ev_data;
+
+        if(mg_match(message->topic, mg_str("nyx/json#"), NULL))
+        {
+            bool is_blob = message->data.len > 4 && mg_match(mg_str_n(message->data.buf, 64 < message->data.len ? 64 : message->data.len), mg_str("*setBLOBVector*"), NULL);
+
+            record(is_blob ? CLASS_BLOB : CLASS_SET, parse_timestamp(mg_str_n(message->data.buf, message->data.len > 512 ? 512 : message->data.len)), message->data.len);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void broker_send_cmd(struct mg_connection *connection, uint64_t seq)
+{
+    char json[256];
+
+    snprintf(json, sizeof(json),
+        "{\"<>\":\"newNumberVector\",\"@device\":\"Load %lu\",\"@name\":\"LOAD_NUMBER\",\"@timestamp\":\"%llu\",\"children\":[{\"<>\":\"oneNumber\",\"@name\":\"VALUE\",\"$\":\"%llu\"}]}",
+        (unsigned long) (seq % m_devices), (unsigned long long) nyx_metrics_now(), (unsigned long long) seq
+    );
+
+    const struct mg_mqtt_opts opts = {
+        .topic = mg_str("nyx/cmd/json"),
+        .message = mg_str(json),
+        .qos = 0,
+    };
+
+    mg_mqtt_pub(connection, &opts);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* LOAD THREAD                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void *load_thread(__attribute__ ((unused)) void *arg)
+{
+    struct mg_mgr mgr;
+
+    mg_mgr_init(&mgr);
+
+    mg_listen(&mgr, INDI_URL, indi_handler, NULL);
+
+    mg_mqtt_listen(&mgr, MQTT_URL, broker_handler, NULL);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint64_t end = 0;
+
+    for(;;)
+    {
+        mg_mgr_poll(&mgr, 1);
+
+        uint64_t now = nyx_metrics_now();
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        if(m_start == 0)
+        {
+            if(m_indi != NULL && m_subscriber != NULL)
+            {
+                m_start = now;
+
+                end = now + 1000000ULL * m_duration;
+            }
+
+            continue;
+        }
+
+        if(now >= end + 1000ULL * DRAIN_MS)
+        {
+            break;
+        }
+
+        if(now >= end)
+        {
+            continue;
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+        /* OPEN LOOP: MESSAGES DUE AT THE CONFIGURED RATES, UNLESS THE BRIDGE IS TOO FAR BEHIND                        */
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        uint64_t elapsed = now - m_start;
+
+        if(m_indi != NULL)
+        {
+            while(m_classes[CLASS_SET].sent < m_set_rate * elapsed / 1000000ULL)
+            {
+                if(m_indi->send.len > MAX_BACKLOG) { m_throttled++; break; }
+
+                indi_send_set(m_indi, m_classes[CLASS_SET].sent++);
+            }
+
+            while(m_classes[CLASS_BLOB].sent < m_blob_rate * elapsed / 1000000ULL)
+            {
+                if(m_indi->send.len > MAX_BACKLOG) { m_throttled++; break; }
+
+                indi_send_blob(m_indi, m_classes[CLASS_BLOB].sent++);
+            }
+        }
+
+        if(m_subscriber != NULL)
+        {
+            while(m_classes[CLASS_CMD].sent < m_cmd_rate * elapsed / 1000000ULL)
+            {
+                if(m_subscriber->send.len > MAX_BACKLOG) { m_throttled++; break; }
+
+                broker_send_cmd(m_subscriber, m_classes[CLASS_CMD].sent++);
+            }
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    mg_mgr_free(&mgr);
+
+    m_done = true;
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* MAIN                                                                                                               */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static double cpu_seconds(int who)
+{
+    struct rusage usage;
+
+    getrusage(who, &usage);
+
+    return (double) usage.ru_utime.tv_sec + (double) usage.ru_utime.tv_usec / 1.0e6
+           +
+           (double) usage.ru_stime.tv_sec + (double) usage.ru_stime.tv_usec / 1.0e6
+    ;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void usage(STR_t name)
+{
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --duration S      measurement duration in seconds (%lu)\n"
+        "  --set-rate N      INDI set* / message frames per second (%lu)\n"
+        "  --mix N,S,T,M     number / switch / text / message weights (%lu,%lu,%lu,%lu)\n"
+        "  --devices N       number of simulated devices (%lu)\n"
+        "  --blob-rate N     INDI BLOBs per second (%lu)\n"
+        "  --blob-size B     raw BLOB size in bytes (%lu)\n"
+        "  --cmd-rate N      MQTT commands per second (%lu)\n",
+        name, m_duration, m_set_rate, m_mix[0], m_mix[1], m_mix[2], m_mix[3], m_devices, m_blob_rate, m_blob_size, m_cmd_rate
+    );
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    static const struct option options[] = {
+        {"duration", required_argument, NULL, 'd'},
+        {"set-rate", required_argument, NULL, 's'},
+        {"mix", required_argument, NULL, 'm'},
+        {"devices", required_argument, NULL, 'n'},
+        {"blob-rate", required_argument, NULL, 'b'},
+        {"blob-size", required_argument, NULL, 'z'},
+        {"cmd-rate", required_argument, NULL, 'c'},
+        {NULL, 0, NULL, 0},
+    };
+
+    for(int opt; (opt = getopt_long(argc, argv, "", options, NULL)) != -1;)
+    {
+        switch(opt)
+        {
+            case 'd': m_duration = strtoul(optarg, NULL, 10); break;
+            case 's': m_set_rate = strtoul(optarg, NULL, 10); break;
+            case 'n': m_devices = strtoul(optarg, NULL, 10); break;
+            case 'b': m_blob_rate = strtoul(optarg, NULL, 10); break;
+            case 'z': m_blob_size = strtoul(optarg, NULL, 10); break;
+            case 'c': m_cmd_rate = strtoul(optarg, NULL, 10); break;
+            case 'm':
+                if(sscanf(optarg, "%lu,%lu,%lu,%lu", &m_mix[0], &m_mix[1], &m_mix[2], &m_mix[3]) == 4) break;
+                /* FALLTHROUGH */
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if(m_devices == 0)
+    {
+        m_devices = 1;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint8_t *raw = malloc(m_blob_size + 1);
+
+    for(size_t i = 0; i < m_blob_size; i++)
+    {
+        raw[i] = (uint8_t) (i * 2654435761U >> 24);
+    }
+
+    m_blob_b64 = malloc(NYX_BASE64_ENCODED_SIZE(m_blob_size) + 1);
+
+    m_blob_b64_len = nyx_base64_encode(m_blob_b64, m_blob_size, raw);
+
+    free(raw);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    setenv("NYX_INDI_URLS", INDI_URL, 1);
+
+    setenv("NYX_STATS_PERIOD", "0", 0);
+
+    nyx_bridge_initialize();
+
+    pthread_t thread;
+
+    pthread_create(&thread, NULL, load_thread, NULL);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* THE BRIDGE RUNS ON THE MAIN THREAD, SO THAT ITS CPU TIME CAN BE TOLD APART FROM THE LOAD GENERATOR'S           */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    double cpu0 = 0.0;
+    double cpu1 = 0.0;
+
+    nyx_realtime_stats_t rt0 = {0};
+    nyx_realtime_stats_t rt1 = {0};
+
+    bool started = false;
+
+    while(m_done == false)
+    {
+        nyx_bridge_poll(MQTT_URL, "", "", 1);
+
+        if(started == false && m_start > 0)
+        {
+            cpu0 = cpu_seconds(RUSAGE_THREAD);
+
+            nyx_realtime_get_stats(&rt0);
+
+            started = true;
+        }
+    }
+
+    cpu1 = cpu_seconds(RUSAGE_THREAD);
+
+    nyx_realtime_get_stats(&rt1);
+
+    const nyx_watchdog_t *watchdog = nyx_watchdog_cumulative();
+
+    uint64_t loop_p99 = nyx_hist_quantile(&watchdog->iteration, 0.99);
+    uint64_t loop_max = watchdog->iteration.max;
+
+    pthread_join(thread, NULL);
+
+    nyx_bridge_finalize();
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    double seconds = (double) m_duration + DRAIN_MS / 1000.0;
+
+    printf("%-15s %10s %10s %10s %9s %9s %9s %9s\n", "direction", "sent", "received", "msg/s", "MB/s", "p50 ms", "p99 ms", "p999 ms");
+
+    for(int cls = 0; cls < CLASSES; cls++)
+    {
+        const class_t *c = &m_classes[cls];
+
+        printf("%-15s %10llu %10llu %10.0f %9.1f %9.3f %9.3f %9.3f\n", CLASS_NAMES[cls],
+            (unsigned long long) c->sent,
+            (unsigned long long) c->received,
+            (double) c->received / (double) m_duration,
+            (double) c->bytes / 1.0e6 / (double) m_duration,
+            (double) nyx_hist_quantile(&c->latency, 0.500) / 1000.0,
+            (double) nyx_hist_quantile(&c->latency, 0.990) / 1000.0,
+            (double) nyx_hist_quantile(&c->latency, 0.999) / 1000.0
+        );
+    }
+
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("\nbridge CPU: %.1f %% of one core, process max RSS: %.1f MB, throttled: %llu\n",
+        100.0 * (cpu1 - cpu0) / seconds,
+        (double) usage.ru_maxrss / 1024.0,
+        (unsigned long long) m_throttled
+    );
+
+    printf("bridge thread: %llu minor / %llu major faults, %llu involuntary switches, loop p99 %.3f ms, max %.3f ms\n",
+        (unsigned long long) (rt1.minor_faults - rt0.minor_faults),
+        (unsigned long long) (rt1.major_faults - rt0.major_faults),
+        (unsigned long long) (rt1.involuntary_switches - rt0.involuntary_switches),
+        (double) loop_p99 / 1000.0,
+        (double) loop_max / 1000.0
+    );
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    free(m_blob_b64);
+
+    return 0;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
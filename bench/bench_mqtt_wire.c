@@ -0,0 +1,151 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/external/mongoose.h"
+
+#include "bench.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define ITERATIONS 1000
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static STR_t SAMPLES[][2] = {
+    {"mount", "<setNumberVector device=\"Telescope Simulator\" name=\"EQUATORIAL_EOD_COORD\" state=\"Busy\" timeout=\"60\" timestamp=\"2024-05-01T21:15:02\"><oneNumber name=\"RA\">5.5912</oneNumber><oneNumber name=\"DEC\">-5.3911</oneNumber></setNumberVector>"},
+    {"weather", "<setNumberVector device=\"Weather Simulator\" name=\"WEATHER_PARAMETERS\" state=\"Ok\" timeout=\"60\" timestamp=\"2024-05-01T21:15:03\"><oneNumber name=\"WEATHER_TEMPERATURE\">11.2</oneNumber><oneNumber name=\"WEATHER_WIND_SPEED\">3.4</oneNumber><oneNumber name=\"WEATHER_RAIN_HOUR\">0</oneNumber></setNumberVector>"},
+    {"switch", "<setSwitchVector device=\"Focuser Simulator\" name=\"FOCUS_MOTION\" state=\"Ok\" timeout=\"60\" timestamp=\"2024-05-01T21:15:04\"><oneSwitch name=\"FOCUS_INWARD\">On</oneSwitch><oneSwitch name=\"FOCUS_OUTWARD\">Off</oneSwitch></setSwitchVector>"},
+    {"message", "<message device=\"CCD Simulator\" timestamp=\"2024-05-01T21:15:05\" message=\"Exposure done, downloading image...\"/>"},
+};
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static str_t m_json = NULL;
+static size_t m_json_len = 0;
+static nyx_meta_t m_meta = {0};
+
+static char m_tag[64];
+static char m_device[64];
+static char m_name[64];
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void json_emit(size_t len, STR_t json, const nyx_meta_t *meta)
+{
+    m_json = nyx_string_ndup(json, len);
+    m_json_len = len;
+
+    snprintf(m_tag, sizeof(m_tag), "%s", meta->tag);
+    snprintf(m_device, sizeof(m_device), "%s", meta->device);
+    snprintf(m_name, sizeof(m_name), "%s", meta->name);
+
+    m_meta.tag = m_tag;
+    m_meta.device = m_device;
+    m_meta.name = m_name;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static double bytes_per_message(struct mg_mgr *mgr, int version, bool with_meta)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    static const uint8_t connack[] = {0x20, 0x06, 0x00, 0x00, 0x03, MQTT_PROP_TOPIC_ALIAS_MAXIMUM, 0x00, 0x0A};
+
+    struct mg_mqtt_message message;
+
+    mg_mqtt_parse(connack, sizeof(connack), 5, &message);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    struct mg_connection *connection = mg_alloc_conn(mgr);
+
+    connection->is_mqtt5 = version == 5;
+
+    nyx_mqtt_open(connection, &message);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    for(int i = 0; i < ITERATIONS; i++)
+    {
+        nyx_mqtt_pub(connection, "nyx/json", 1, with_meta ? &m_meta : NULL, m_json_len, m_json, 2);
+    }
+
+    double result = (double) connection->send.len / ITERATIONS;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    mg_iobuf_free(&connection->send);
+
+    free(connection);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return result;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int main(void)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    struct mg_mgr mgr;
+
+    mg_mgr_init(&mgr);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    printf("%-10s %8s %10s %14s %16s\n", "sample", "payload", "MQTT 3.1.1", "MQTT 5 alias", "MQTT 5 alias+meta");
+
+    for(size_t i = 0; i < sizeof(SAMPLES) / sizeof(SAMPLES[0]); i++)
+    {
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        nyx_x2j_ctx_t *x2j = nyx_x2j_init(json_emit);
+
+        nyx_x2j_feed(x2j, strlen(SAMPLES[i][1]), SAMPLES[i][1]);
+
+        nyx_x2j_close(x2j);
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        if(m_json == NULL)
+        {
+            fprintf(stderr, "Cannot convert sample `%s`\n", SAMPLES[i][0]);
+
+            return 1;
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        double v4 = bytes_per_message(&mgr, 4, false);
+        double v5 = bytes_per_message(&mgr, 5, false);
+        double v5_meta = bytes_per_message(&mgr, 5, true);
+
+        printf("%-10s %8zu %10.1f %14.1f %16.1f\n", SAMPLES[i][0], m_json_len, v4, v5, v5_meta);
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        nyx_memory_free(m_json);
+
+        m_json = NULL;
+
+        /*------------------------------------------------------------------------------------------------------------*/
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    mg_mgr_free(&mgr);
+
+    return 0;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,412 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#ifndef NYX_BENCH_CORPUS
+#  define NYX_BENCH_CORPUS "bench/corpus"
+#endif
+
+#define MIN_DURATION_NS 200000000ULL
+
+#define MAX_MESSAGES 1024
+
+#define BLOB_SIZE (1024 * 1024)
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static STR_t CORPUS[] = {"mount", "ccd", "weather", "focuser"};
+
+static const size_t CHUNK_SIZES[] = {0, 4096, 1460, 64}; /* 0: WHOLE STREAM */
+
+static const struct
+{
+    STR_t name;
+
+    uint32_t flags;
+
+} ESCAPES[] = {
+    {"none", NYX_SB_NO_ESCAPE},
+    {"json", NYX_SB_ESCAPE_JSON},
+    {"xml", NYX_SB_ESCAPE_XML},
+};
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    STR_t name;
+
+    str_t xml;
+
+    size_t xml_len;
+
+    str_t json[MAX_MESSAGES];
+
+    size_t json_len[MAX_MESSAGES];
+
+    size_t json_cnt;
+
+} corpus_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static corpus_t *m_capture = NULL;
+
+static uint64_t m_messages = 0;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void json_emit(size_t len, STR_t json, __attribute__ ((unused)) const nyx_meta_t *meta)
+{
+    if(m_capture != NULL && m_capture->json_cnt < MAX_MESSAGES)
+    {
+        m_capture->json[m_capture->json_cnt] = nyx_string_ndup(json, len);
+        m_capture->json_len[m_capture->json_cnt] = len;
+
+        m_capture->json_cnt++;
+    }
+
+    m_messages++;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void xml_emit(__attribute__ ((unused)) size_t len, __attribute__ ((unused)) STR_t xml, __attribute__ ((unused)) const nyx_meta_t *meta)
+{
+    m_messages++;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static str_t load_file(STR_t dir, STR_t name, size_t *len)
+{
+    char path[1024];
+
+    snprintf(path, sizeof(path), "%s/%s.xml", dir, name);
+
+    FILE *fp = fopen(path, "rb");
+
+    if(fp == NULL)
+    {
+        return NULL;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    *len = (size_t) ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    str_t result = malloc(*len + 1);
+
+    *len = fread(result, 1, *len, fp);
+
+    result[*len] = '\0';
+
+    fclose(fp);
+
+    return result;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static str_t make_blob(size_t *len)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* SYNTHETIC 1 MiB FRAME, FOR THE LARGE MESSAGE END OF THE SPECTRUM                                               */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint8_t *raw = malloc(BLOB_SIZE);
+
+    uint32_t seed = 0x12345678;
+
+    for(size_t i = 0; i < BLOB_SIZE; i++)
+    {
+        seed = seed * 1664525U + 1013904223U;
+
+        raw[i] = (uint8_t) ((i & 1) == 0 ? 0x03 + (seed >> 30) : seed >> 24);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    char head[256];
+
+    int head_len = snprintf(head, sizeof(head), "<setBLOBVector device=\"CCD Simulator\" name=\"CCD1\" state=\"Ok\" timeout=\"60\" timestamp=\"2024-05-01T21:15:07\"><oneBLOB name=\"CCD1\" size=\"%d\" format=\".fits\">", BLOB_SIZE);
+
+    STR_t tail = "</oneBLOB></setBLOBVector>";
+
+    str_t result = malloc((size_t) head_len + NYX_BASE64_ENCODED_SIZE(BLOB_SIZE) + strlen(tail) + 1);
+
+    memcpy(result, head, (size_t) head_len);
+
+    size_t b64_len = nyx_base64_encode(result + head_len, BLOB_SIZE, raw);
+
+    strcpy(result + head_len + b64_len, tail);
+
+    *len = (size_t) head_len + b64_len + strlen(tail);
+
+    free(raw);
+
+    return result;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void bench_x2j(corpus_t *corpus, size_t chunk_size)
+{
+    nyx_x2j_ctx_t *x2j = nyx_x2j_init(json_emit);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_memory_stats_t s0;
+    nyx_memory_stats_t s1;
+
+    uint64_t bytes = 0;
+
+    m_messages = 0;
+
+    nyx_memory_get_stats(&s0);
+
+    uint64_t t0 = bench_now_ns();
+    uint64_t t1;
+
+    do
+    {
+        size_t step = chunk_size > 0 ? chunk_size : corpus->xml_len;
+
+        for(size_t i = 0; i < corpus->xml_len; i += step)
+        {
+            nyx_x2j_feed(x2j, i + step < corpus->xml_len ? step : corpus->xml_len - i, corpus->xml + i);
+        }
+
+        bytes += corpus->xml_len;
+
+    } while((t1 = bench_now_ns()) - t0 < MIN_DURATION_NS);
+
+    nyx_memory_get_stats(&s1);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    char chunk[16];
+
+    snprintf(chunk, sizeof(chunk), chunk_size > 0 ? "%zu" : "whole", chunk_size);
+
+    double seconds = (double) (t1 - t0) / 1.0e9;
+
+    printf("%-8s %-9s %-6s %12.0f %10.1f %12.2f\n", corpus->name, "xml>json", chunk,
+        (double) m_messages / seconds,
+        (double) bytes / 1.0e6 / seconds,
+        m_messages > 0 ? (double) (s1.allocs - s0.allocs) / (double) m_messages : 0.0
+    );
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_x2j_close(x2j);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void bench_j2x(const corpus_t *corpus)
+{
+    nyx_j2x_ctx_t *j2x = nyx_j2x_init(xml_emit);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_memory_stats_t s0;
+    nyx_memory_stats_t s1;
+
+    uint64_t bytes = 0;
+
+    m_messages = 0;
+
+    nyx_memory_get_stats(&s0);
+
+    uint64_t t0 = bench_now_ns();
+    uint64_t t1;
+
+    do
+    {
+        for(size_t i = 0; i < corpus->json_cnt; i++)
+        {
+            nyx_j2x_feed(j2x, corpus->json_len[i], corpus->json[i]);
+
+            bytes += corpus->json_len[i];
+        }
+
+    } while((t1 = bench_now_ns()) - t0 < MIN_DURATION_NS);
+
+    nyx_memory_get_stats(&s1);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    double seconds = (double) (t1 - t0) / 1.0e9;
+
+    printf("%-8s %-9s %-6s %12.0f %10.1f %12.2f\n", corpus->name, "json>xml", "-",
+        (double) m_messages / seconds,
+        (double) bytes / 1.0e6 / seconds,
+        m_messages > 0 ? (double) (s1.allocs - s0.allocs) / (double) m_messages : 0.0
+    );
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_j2x_close(j2x);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void bench_string_builder(const corpus_t *corpus, STR_t escape_name, uint32_t flags)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* ONE APPEND PER LINE, AS THE CONVERTERS APPEND ATTRIBUTES AND TEXT NODES                                        */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint64_t bytes = 0;
+
+    uint64_t strings = 0;
+
+    uint64_t t0 = bench_now_ns();
+    uint64_t t1;
+
+    do
+    {
+        nyx_string_builder_t *sb = nyx_string_builder_new();
+
+        for(size_t i = 0; i < corpus->xml_len;)
+        {
+            STR_t p = corpus->xml + i;
+
+            STR_t q = memchr(p, '\n', corpus->xml_len - i);
+
+            size_t n = q != NULL ? (size_t) (q - p) + 1 : corpus->xml_len - i;
+
+            nyx_string_builder_append_buff(sb, flags, n, p);
+
+            i += n;
+        }
+
+        str_t result = nyx_string_builder_to_string(sb);
+
+        nyx_memory_free(result);
+
+        nyx_string_builder_free(sb);
+
+        bytes += corpus->xml_len;
+
+        strings++;
+
+    } while((t1 = bench_now_ns()) - t0 < MIN_DURATION_NS);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    double seconds = (double) (t1 - t0) / 1.0e9;
+
+    printf("%-8s %-9s %-6s %12.0f %10.1f %12s\n", corpus->name, "sb", escape_name,
+        (double) strings / seconds,
+        (double) bytes / 1.0e6 / seconds,
+        "-"
+    );
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+    STR_t dir = argc > 1 ? argv[1] : NYX_BENCH_CORPUS;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    size_t corpus_cnt = sizeof(CORPUS) / sizeof(CORPUS[0]) + 1;
+
+    corpus_t *corpora = calloc(corpus_cnt, sizeof(corpus_t));
+
+    for(size_t i = 0; i < corpus_cnt - 1; i++)
+    {
+        corpora[i].name = CORPUS[i];
+
+        corpora[i].xml = load_file(dir, CORPUS[i], &corpora[i].xml_len);
+
+        if(corpora[i].xml == NULL)
+        {
+            fprintf(stderr, "Cannot read corpus `%s/%s.xml`\n", dir, CORPUS[i]);
+
+            return 1;
+        }
+    }
+
+    corpora[corpus_cnt - 1].name = "blob-1M";
+
+    corpora[corpus_cnt - 1].xml = make_blob(&corpora[corpus_cnt - 1].xml_len);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* THE JSON -> XML CORPUS IS THE OUTPUT OF THE XML -> JSON ONE                                                    */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    for(size_t i = 0; i < corpus_cnt; i++)
+    {
+        nyx_x2j_ctx_t *x2j = nyx_x2j_init(json_emit);
+
+        m_capture = &corpora[i];
+
+        nyx_x2j_feed(x2j, corpora[i].xml_len, corpora[i].xml);
+
+        m_capture = NULL;
+
+        nyx_x2j_close(x2j);
+
+        if(corpora[i].json_cnt == 0)
+        {
+            fprintf(stderr, "Cannot convert corpus `%s`\n", corpora[i].name);
+
+            return 1;
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    printf("%-8s %-9s %-6s %12s %10s %12s\n", "corpus", "path", "mode", "msg/s", "MB/s", "allocs/msg");
+
+    for(size_t i = 0; i < corpus_cnt; i++)
+    {
+        for(size_t j = 0; j < sizeof(CHUNK_SIZES) / sizeof(CHUNK_SIZES[0]); j++)
+        {
+            bench_x2j(&corpora[i], CHUNK_SIZES[j]);
+        }
+
+        bench_j2x(&corpora[i]);
+
+        for(size_t j = 0; j < sizeof(ESCAPES) / sizeof(ESCAPES[0]); j++)
+        {
+            bench_string_builder(&corpora[i], ESCAPES[j].name, ESCAPES[j].flags);
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    for(size_t i = 0; i < corpus_cnt; i++)
+    {
+        for(size_t j = 0; j < corpora[i].json_cnt; j++)
+        {
+            nyx_memory_free(corpora[i].json[j]);
+        }
+
+        free(corpora[i].xml);
+    }
+
+    free(corpora);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return 0;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,278 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define MAX_SOURCES 256
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static STR_t DIRECTION_NAMES[] = {
+    [NYX_CAPTURE_INDI] = "indi>mqtt",
+    [NYX_CAPTURE_MQTT] = "mqtt>indi",
+};
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    uint64_t records;
+
+    uint64_t bytes_in;
+
+    uint64_t messages;
+
+    uint64_t bytes_out;
+
+    nyx_hist_t feed_ns;
+
+} direction_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    double speed;
+
+    uint64_t first_timestamp;
+
+    uint64_t first_now;
+
+    nyx_x2j_ctx_t *x2j[MAX_SOURCES];
+
+    nyx_j2x_ctx_t *j2x;
+
+} replay_ctx_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static direction_t m_directions[2];
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void json_emit(size_t len, __attribute__ ((unused)) STR_t json, __attribute__ ((unused)) const nyx_meta_t *meta)
+{
+    m_directions[NYX_CAPTURE_INDI].messages++;
+
+    m_directions[NYX_CAPTURE_INDI].bytes_out += len;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void xml_emit(size_t len, __attribute__ ((unused)) STR_t xml, __attribute__ ((unused)) const nyx_meta_t *meta)
+{
+    m_directions[NYX_CAPTURE_MQTT].messages++;
+
+    m_directions[NYX_CAPTURE_MQTT].bytes_out += len;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void sleep_until_ns(uint64_t deadline)
+{
+    const struct timespec ts = {
+        .tv_sec = (time_t) (deadline / 1000000000ULL),
+        .tv_nsec = (long) (deadline % 1000000000ULL),
+    };
+
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool replay_record(const nyx_capture_header_t *header, BUFF_t buff, buff_t arg)
+{
+    replay_ctx_t *ctx = arg;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* A NEW SESSION (RESTART OF THE BRIDGE) HAS ITS OWN CLOCK ORIGIN AND ITS OWN STREAMS                             */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    bool session = header->kind == NYX_CAPTURE_SESSION;
+
+    if(session && ctx->first_now != 0)
+    {
+        for(size_t i = 0; i < MAX_SOURCES; i++)
+        {
+            if(ctx->x2j[i] != NULL)
+            {
+                nyx_x2j_close(ctx->x2j[i]);
+
+                ctx->x2j[i] = NULL;
+            }
+        }
+
+        nyx_j2x_close(ctx->j2x);
+
+        ctx->j2x = nyx_j2x_init(xml_emit);
+
+        nyx_j2x_set_stream_threshold(ctx->j2x, NYX_J2X_STREAM_THRESHOLD);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* PACING: OFFSETS FROM THE FIRST RECORD OF THE SESSION, DIVIDED BY THE SPEED FACTOR (0 = AS FAST AS POSSIBLE)    */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(ctx->first_now == 0 || session)
+    {
+        ctx->first_timestamp = header->timestamp;
+
+        ctx->first_now = bench_now_ns();
+    }
+    else if(ctx->speed > 0.0 && header->timestamp > ctx->first_timestamp)
+    {
+        sleep_until_ns(ctx->first_now + (uint64_t) (1000.0 * (double) (header->timestamp - ctx->first_timestamp) / ctx->speed));
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(header->kind != NYX_CAPTURE_INDI && header->kind != NYX_CAPTURE_MQTT)
+    {
+        return true;
+    }
+
+    direction_t *direction = &m_directions[header->kind];
+
+    uint64_t t0 = bench_now_ns();
+
+    if(header->kind == NYX_CAPTURE_INDI)
+    {
+        nyx_x2j_ctx_t **x2j = &ctx->x2j[header->source & (MAX_SOURCES - 1)];
+
+        if(*x2j == NULL)
+        {
+            *x2j = nyx_x2j_init(json_emit);
+        }
+
+        nyx_x2j_feed(*x2j, header->len, buff);
+    }
+    else
+    {
+        nyx_j2x_feed(ctx->j2x, header->len, buff);
+    }
+
+    nyx_hist_record(&direction->feed_ns, bench_now_ns() - t0);
+
+    direction->records++;
+
+    direction->bytes_in += header->len;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    replay_ctx_t ctx = {
+        .speed = 1.0,
+    };
+
+    STR_t path = NULL;
+
+    for(int i = 1; i < argc; i++)
+    {
+        /**/ if(strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            ctx.speed = strtod(argv[++i], NULL);
+        }
+        else if(strcmp(argv[i], "--fast") == 0) {
+            ctx.speed = 0.0;
+        }
+        else {
+            path = argv[i];
+        }
+    }
+
+    if(path == NULL)
+    {
+        fprintf(stderr, "Usage: %s [--speed N | --fast] <capture file>\n", argv[0]);
+
+        return 1;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    ctx.j2x = nyx_j2x_init(xml_emit);
+
+    nyx_j2x_set_stream_threshold(ctx.j2x, NYX_J2X_STREAM_THRESHOLD);
+
+    uint64_t t0 = bench_now_ns();
+
+    bool complete = nyx_capture_replay(path, replay_record, &ctx);
+
+    uint64_t t1 = bench_now_ns();
+
+    nyx_j2x_close(ctx.j2x);
+
+    for(size_t i = 0; i < MAX_SOURCES; i++)
+    {
+        if(ctx.x2j[i] != NULL)
+        {
+            nyx_x2j_close(ctx.x2j[i]);
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(ctx.first_now == 0)
+    {
+        fprintf(stderr, "Cannot read capture `%s`\n", path);
+
+        return 1;
+    }
+
+    if(complete == false)
+    {
+        fprintf(stderr, "Capture `%s` is truncated, replayed up to the last complete record\n", path);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    double seconds = (double) (t1 - t0) / 1.0e9;
+
+    printf("%-10s %9s %11s %9s %10s %9s %11s %11s %11s\n", "direction", "records", "bytes in", "messages", "msg/s", "MB/s", "p50 us", "p99 us", "max us");
+
+    for(int i = 0; i < 2; i++)
+    {
+        const direction_t *direction = &m_directions[i];
+
+        printf("%-10s %9llu %11llu %9llu %10.0f %9.1f %11.1f %11.1f %11.1f\n", DIRECTION_NAMES[i],
+            (unsigned long long) direction->records,
+            (unsigned long long) direction->bytes_in,
+            (unsigned long long) direction->messages,
+            (double) direction->messages / seconds,
+            (double) direction->bytes_in / 1.0e6 / seconds,
+            (double) nyx_hist_quantile(&direction->feed_ns, 0.50) / 1000.0,
+            (double) nyx_hist_quantile(&direction->feed_ns, 0.99) / 1000.0,
+            (double) direction->feed_ns.max / 1000.0
+        );
+    }
+
+    if(ctx.speed > 0.0)
+    {
+        printf("\nreplayed in %.3f s at %gx\n", seconds, ctx.speed);
+    }
+    else
+    {
+        printf("\nreplayed in %.3f s, as fast as possible\n", seconds);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return complete ? 0 : 1;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,473 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#  define HAVE_X86_KERNELS
+#endif
+
+#include "bridge.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static const char BASE64_CHARS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static int m_level = -1;
+
+static uint8_t m_decode_lut[256];
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* SCALAR KERNELS                                                                                                     */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static size_t encode_scalar(str_t dst, size_t len, const uint8_t *p)
+{
+    str_t q = dst;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    for(; len >= 3; len -= 3, p += 3)
+    {
+        uint32_t triple = ((uint32_t) p[0] << 16) | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 0);
+
+        *q++ = BASE64_CHARS[(triple >> 18) & 0x3F];
+        *q++ = BASE64_CHARS[(triple >> 12) & 0x3F];
+        *q++ = BASE64_CHARS[(triple >> 6) & 0x3F];
+        *q++ = BASE64_CHARS[(triple >> 0) & 0x3F];
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(len > 0)
+    {
+        uint32_t triple = ((uint32_t) p[0] << 16) | (len > 1 ? ((uint32_t) p[1] << 8) : 0);
+
+        *q++ = BASE64_CHARS[(triple >> 18) & 0x3F];
+        *q++ = BASE64_CHARS[(triple >> 12) & 0x3F];
+        *q++ = len > 1 ? BASE64_CHARS[(triple >> 6) & 0x3F] : '=';
+        *q++ = '=';
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return (size_t) (q - dst);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static size_t decode_scalar(uint8_t *dst, size_t len, STR_t src)
+{
+    uint8_t *q = dst;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint32_t quad = 0;
+
+    int n = 0;
+
+    for(size_t i = 0; i < len; i++)
+    {
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        uint32_t v = m_decode_lut[(uint8_t) src[i]];
+
+        /**/ if(v == 0xFE) break;    /* '=' */
+        else if(v == 0xFF) continue; /* whitespace and garbage */
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        quad = (quad << 6) | v;
+
+        if(++n == 4)
+        {
+            *q++ = (uint8_t) (quad >> 16);
+            *q++ = (uint8_t) (quad >> 8);
+            *q++ = (uint8_t) (quad >> 0);
+
+            quad = 0;
+            n = 0;
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    /**/ if(n == 3)
+    {
+        *q++ = (uint8_t) (quad >> 10);
+        *q++ = (uint8_t) (quad >> 2);
+    }
+    else if(n == 2)
+    {
+        *q++ = (uint8_t) (quad >> 4);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return (size_t) (q - dst);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* SSSE3 / AVX2 KERNELS                                                                                               */
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Encoding follows W. Muła's reshuffle + pshufb lookup, decoding classifies the ASCII ranges with compares and       */
+/* packs the sextets with pmaddubsw / pmaddwd. Kernels only process whole blocks and stop at the first block holding  */
+/* a character outside of the base64 alphabet (padding, whitespace), the scalar code finishing the job.               */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#ifdef HAVE_X86_KERNELS
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+__attribute__ ((target("ssse3")))
+static __m128i enc_reshuffle_128(__m128i in)
+{
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+    __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00));
+    __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003F03F0));
+    __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+
+    return _mm_or_si128(t1, t3);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+__attribute__ ((target("ssse3")))
+static __m128i enc_translate_128(__m128i in)
+{
+    __m128i result = _mm_subs_epu8(in, _mm_set1_epi8(51));
+
+    __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), in);
+
+    result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+
+    __m128i shift_lut = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0
+    );
+
+    return _mm_add_epi8(_mm_shuffle_epi8(shift_lut, result), in);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+__attribute__ ((target("ssse3")))
+static size_t encode_ssse3(str_t dst, size_t *len, const uint8_t **src)
+{
+    str_t q = dst;
+
+    /* 12 bytes consumed per 16-byte load */
+
+    for(; *len >= 16; *len -= 12, *src += 12, q += 16)
+    {
+        __m128i in = _mm_loadu_si128((const __m128i *) *src);
+
+        _mm_storeu_si128((__m128i *) q, enc_translate_128(enc_reshuffle_128(in)));
+    }
+
+    return (size_t) (q - dst);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+__attribute__ ((target("avx2")))
+static size_t encode_avx2(str_t dst, size_t *len, const uint8_t **src)
+{
+    str_t q = dst;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    const __m256i shuffle = _mm256_set_epi8(
+        10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+        10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1
+    );
+
+    const __m256i shift_lut = _mm256_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0
+    );
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    /* 24 bytes consumed per pair of 16-byte loads (the second one starts at +12) */
+
+    for(; *len >= 28; *len -= 24, *src += 24, q += 32)
+    {
+        __m256i in = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) (*src + 0))),
+            /*-------------------*/_mm_loadu_si128((const __m128i *) (*src + 12)),
+            1
+        );
+
+        in = _mm256_shuffle_epi8(in, shuffle);
+
+        __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00));
+        __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0));
+        __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+
+        __m256i indices = _mm256_or_si256(t1, t3);
+
+        __m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+
+        __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+
+        result = _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+
+        _mm256_storeu_si256((__m256i *) q, _mm256_add_epi8(_mm256_shuffle_epi8(shift_lut, result), indices));
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return (size_t) (q - dst);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+__attribute__ ((target("ssse3")))
+static size_t decode_ssse3(uint8_t *dst, size_t *len, STR_t *src)
+{
+    uint8_t *q = dst;
+
+    uint8_t temp[16];
+
+    for(; *len >= 16; *len -= 16, *src += 16, q += 12)
+    {
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        __m128i c = _mm_loadu_si128((const __m128i *) *src);
+
+        __m128i is_u = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('A' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), c));
+        __m128i is_l = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), c));
+        __m128i is_d = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), c));
+        __m128i is_p = _mm_cmpeq_epi8(c, _mm_set1_epi8('+'));
+        __m128i is_s = _mm_cmpeq_epi8(c, _mm_set1_epi8('/'));
+
+        __m128i valid = _mm_or_si128(_mm_or_si128(is_u, is_l), _mm_or_si128(is_d, _mm_or_si128(is_p, is_s)));
+
+        if(_mm_movemask_epi8(valid) != 0xFFFF)
+        {
+            break;
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        __m128i shift = _mm_or_si128(
+            _mm_or_si128(
+                _mm_and_si128(is_u, _mm_set1_epi8(-65)),
+                _mm_and_si128(is_l, _mm_set1_epi8(-71))
+            ),
+            _mm_or_si128(
+                _mm_and_si128(is_d, _mm_set1_epi8(+4)),
+                _mm_or_si128(
+                    _mm_and_si128(is_p, _mm_set1_epi8(19)),
+                    _mm_and_si128(is_s, _mm_set1_epi8(16))
+                )
+            )
+        );
+
+        __m128i v = _mm_add_epi8(c, shift);
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+        v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+        v = _mm_shuffle_epi8(v, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+        _mm_storeu_si128((__m128i *) temp, v);
+
+        memcpy(q, temp, 12);
+
+        /*------------------------------------------------------------------------------------------------------------*/
+    }
+
+    return (size_t) (q - dst);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+__attribute__ ((target("avx2")))
+static size_t decode_avx2(uint8_t *dst, size_t *len, STR_t *src)
+{
+    uint8_t *q = dst;
+
+    uint8_t temp[32];
+
+    for(; *len >= 32; *len -= 32, *src += 32, q += 24)
+    {
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        __m256i c = _mm256_loadu_si256((const __m256i *) *src);
+
+        __m256i is_u = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('A' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), c));
+        __m256i is_l = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), c));
+        __m256i is_d = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+        __m256i is_p = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('+'));
+        __m256i is_s = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('/'));
+
+        __m256i valid = _mm256_or_si256(_mm256_or_si256(is_u, is_l), _mm256_or_si256(is_d, _mm256_or_si256(is_p, is_s)));
+
+        if((uint32_t) _mm256_movemask_epi8(valid) != 0xFFFFFFFFU)
+        {
+            break;
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        __m256i shift = _mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_and_si256(is_u, _mm256_set1_epi8(-65)),
+                _mm256_and_si256(is_l, _mm256_set1_epi8(-71))
+            ),
+            _mm256_or_si256(
+                _mm256_and_si256(is_d, _mm256_set1_epi8(+4)),
+                _mm256_or_si256(
+                    _mm256_and_si256(is_p, _mm256_set1_epi8(19)),
+                    _mm256_and_si256(is_s, _mm256_set1_epi8(16))
+                )
+            )
+        );
+
+        __m256i v = _mm256_add_epi8(c, shift);
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+        v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+        v = _mm256_shuffle_epi8(v, _mm256_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+        ));
+
+        _mm256_storeu_si256((__m256i *) temp, v);
+
+        memcpy(q + 0x00, temp + 0x00, 12);
+        memcpy(q + 0x0C, temp + 0x10, 12);
+
+        /*------------------------------------------------------------------------------------------------------------*/
+    }
+
+    return (size_t) (q - dst);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#endif
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* API                                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static int cpu_level(void)
+{
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+
+    /**/ if(__builtin_cpu_supports("avx2")) {
+        return NYX_BASE64_AVX2;
+    }
+    else if(__builtin_cpu_supports("ssse3")) {
+        return NYX_BASE64_SSSE3;
+    }
+#endif
+    return NYX_BASE64_SCALAR;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int nyx_base64_set_level(int level)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    memset(m_decode_lut, 0xFF, sizeof(m_decode_lut));
+
+    for(int i = 0; i < 64; i++)
+    {
+        m_decode_lut[(uint8_t) BASE64_CHARS[i]] = (uint8_t) i;
+    }
+
+    m_decode_lut['='] = 0xFE;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    int max_level = cpu_level();
+
+    return m_level = (level < 0 || level > max_level) ? max_level : level;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+size_t nyx_base64_encode(str_t dst, size_t len, BUFF_t src)
+{
+    const uint8_t *p = (const uint8_t *) src;
+
+    str_t q = dst;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(m_level < 0)
+    {
+        nyx_base64_set_level(-1);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+#ifdef HAVE_X86_KERNELS
+    /**/ if(m_level >= NYX_BASE64_AVX2) {
+        q += encode_avx2(q, &len, &p);
+        q += encode_ssse3(q, &len, &p);
+    }
+    else if(m_level >= NYX_BASE64_SSSE3) {
+        q += encode_ssse3(q, &len, &p);
+    }
+#endif
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return (size_t) (q - dst) + encode_scalar(q, len, p);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+size_t nyx_base64_decode(buff_t dst, size_t len, STR_t src)
+{
+    uint8_t *q = (uint8_t *) dst;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(m_level < 0)
+    {
+        nyx_base64_set_level(-1);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+#ifdef HAVE_X86_KERNELS
+    /**/ if(m_level >= NYX_BASE64_AVX2) {
+        q += decode_avx2(q, &len, &src);
+        q += decode_ssse3(q, &len, &src);
+    }
+    else if(m_level >= NYX_BASE64_SSSE3) {
+        q += decode_ssse3(q, &len, &src);
+    }
+#endif
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return (size_t) (q - (uint8_t *) dst) + decode_scalar(q, len, src);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,232 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bridge.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* TARGET (DEVICE OR DEVICE + PROPERTY) -> (CLIENT -> LEASE EXPIRY)                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    uint64_t expiry;
+
+} lease_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    str_t device;
+
+    str_t name;
+
+    char policy[8];
+
+    nyx_string_map_t *leases;
+
+} target_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static nyx_string_map_t *m_targets = NULL;
+
+static nyx_blob_demand_fn m_apply_fn = NULL;
+
+static uint64_t m_now = 0;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void key_of(str_t dst, size_t size, STR_t device, STR_t name)
+{
+    snprintf(dst, size, "%s\n%s", device, name != NULL ? name : "");
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool free_lease(__attribute__ ((unused)) STR_t client, buff_t lease, __attribute__ ((unused)) buff_t arg)
+{
+    nyx_memory_free(lease);
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool expire_lease(__attribute__ ((unused)) STR_t client, buff_t lease, __attribute__ ((unused)) buff_t arg)
+{
+    if(((lease_t *) lease)->expiry <= m_now)
+    {
+        nyx_memory_free(lease);
+
+        return true;
+    }
+
+    return false;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void target_free(target_t *target)
+{
+    nyx_string_map_foreach(target->leases, free_lease, NULL);
+
+    nyx_string_map_free(target->leases);
+
+    nyx_memory_free(target->device);
+    nyx_memory_free(target->name);
+
+    nyx_memory_free(target);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool free_target(__attribute__ ((unused)) STR_t key, buff_t target, __attribute__ ((unused)) buff_t arg)
+{
+    target_free(target);
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool expire_target(__attribute__ ((unused)) STR_t key, buff_t arg1, __attribute__ ((unused)) buff_t arg2)
+{
+    target_t *target = arg1;
+
+    nyx_string_map_foreach(target->leases, expire_lease, NULL);
+
+    if(nyx_string_map_size(target->leases) == 0)
+    {
+        m_apply_fn(target->device, target->name, "Never");
+
+        target_free(target);
+
+        return true;
+    }
+
+    return false;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool replay_target(__attribute__ ((unused)) STR_t key, buff_t arg1, __attribute__ ((unused)) buff_t arg2)
+{
+    const target_t *target = arg1;
+
+    m_apply_fn(target->device, target->name, target->policy);
+
+    return false;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_blob_demand_init(nyx_blob_demand_fn apply_fn)
+{
+    m_targets = nyx_string_map_new();
+
+    m_apply_fn = apply_fn;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_blob_demand_free(void)
+{
+    if(m_targets != NULL)
+    {
+        nyx_string_map_foreach(m_targets, free_target, NULL);
+
+        nyx_string_map_free(m_targets);
+
+        m_targets = NULL;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* policy IS "Also" OR "Only" TO TAKE OR RENEW A LEASE, "Never" TO RELEASE IT; THE LATEST POLICY OF A TARGET APPLIES  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_blob_demand_update(STR_t device, STR_t name, STR_t client, STR_t policy, uint64_t expiry)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    char key[256];
+
+    key_of(key, sizeof(key), device, name);
+
+    target_t *target = nyx_string_map_get(m_targets, key);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(strcmp(policy, "Never") != 0)
+    {
+        if(target == NULL)
+        {
+            target = nyx_memory_alloc(sizeof(target_t));
+
+            memset(target, 0x00, sizeof(target_t));
+
+            target->device = nyx_string_dup(device);
+            target->name = name != NULL && name[0] != '\0' ? nyx_string_dup(name) : NULL;
+            target->leases = nyx_string_map_new();
+
+            nyx_string_map_put(m_targets, key, target);
+        }
+
+        if(strcmp(target->policy, policy) != 0)
+        {
+            snprintf(target->policy, sizeof(target->policy), "%s", policy);
+
+            m_apply_fn(target->device, target->name, target->policy);
+        }
+
+        lease_t *lease = nyx_string_map_get(target->leases, client);
+
+        if(lease == NULL)
+        {
+            nyx_string_map_put(target->leases, client, lease = nyx_memory_alloc(sizeof(lease_t)));
+        }
+
+        lease->expiry = expiry;
+    }
+    else if(target != NULL)
+    {
+        nyx_memory_free(nyx_string_map_del(target->leases, client));
+
+        if(nyx_string_map_size(target->leases) == 0)
+        {
+            nyx_string_map_del(m_targets, key);
+
+            m_apply_fn(target->device, target->name, "Never");
+
+            target_free(target);
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_blob_demand_expire(uint64_t now)
+{
+    m_now = now;
+
+    nyx_string_map_foreach(m_targets, expire_target, NULL);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_blob_demand_replay(void)
+{
+    nyx_string_map_foreach(m_targets, replay_target, NULL);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -5,6 +5,9 @@
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+#include <signal.h>
+#include <sys/socket.h>
+
 #include "bridge.h"
 
 #include "external/mongoose.h"
@@ -13,6 +16,8 @@
 
 #define MQTT_CLIENT_NAME "$$nyx-indi-bridge$$"
 
+#define MQTT_CLIENT_NAME_BULK "$$nyx-indi-bridge-bulk$$"
+
 /*--------------------------------------------------------------------------------------------------------------------*/
 
 #define MQTT_TOPIC_PING "nyx/ping/special"
@@ -21,33 +26,194 @@
 
 #define MQTT_TOPIC_OUT "nyx/json"
 
+#define MQTT_TOPIC_BLOB "nyx/blob"
+
+#define MQTT_TOPIC_STATS "nyx/stats"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define MQTT_ALIAS_OUT 1
+
+#define MQTT_ALIAS_OUT_COMPRESSED 2
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define COMPRESS_THRESHOLD 4096UL
+
+#define BLOB_LEASE 60UL
+
+#define STATS_PERIOD 10UL
+
+#define COMMAND_SLOW 2000UL
+
+#define COMMAND_TIMEOUT 30UL
+
+#define STALL_BUDGET 250UL
+
+#define INDI_QUEUE 64UL
+
+#define INDI_QUEUE_TTL 10UL
+
+#define WS_QUEUE 1024UL
+
+#define SPOOL_SIZE 64UL
+
+#define SPOOL_RATE 256UL
+
+#define RT_PRIORITY 50UL
+
+#define RT_HEAP 64UL
+
+#define TRACE_FILE "/tmp/indi_nyx_trace.json"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define MAX_UPSTREAMS 16
+
+#define MAX_RECV_FDS 16
+
+#define RECV_BUFF_SIZE 65536
+
+#define MAX_QUEUE_BYTES (16UL * 1024UL * 1024UL)
+
+#define SPOOL_PERIOD 100UL
+
+#define MAX_SESSION_BYTES (16UL * 1024UL * 1024UL)
+
 /*--------------------------------------------------------------------------------------------------------------------*/
 
 static struct mg_mgr m_mgr = {0};
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-static STR_t m_indi_url = NULL;
 static str_t m_mqtt_url = NULL;
 static str_t m_mqtt_user = NULL;
 static str_t m_mqtt_pass = NULL;
 
 static struct mg_mqtt_opts m_mqtt_opts = {0};
 
+static struct mg_mqtt_prop m_mqtt_session_prop = {0};
+
+static nyx_mqtt_session_t *m_mqtt_session = NULL;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    str_t url;
+
+    struct mg_connection *connection;
+
+    nyx_x2j_ctx_t *x2j;
+
+    nyx_queue_t *queue;
+
+    bool is_unix;
+
+    bool connected;
+
+    bool refresh;
+
+    uint64_t connects;
+
+} upstream_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static upstream_t m_upstreams[MAX_UPSTREAMS] = {0};
+
+static size_t m_upstream_cnt = 0;
+
+static upstream_t *m_current_upstream = NULL;
+
+static uint64_t m_command_seq = 0;
+
+static uint64_t m_tracked_seq = 0;
+
+static nyx_string_map_t *m_device_index = NULL;
+
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-static struct mg_connection *m_indi_connection = NULL;
 static struct mg_connection *m_mqtt_connection = NULL;
+static struct mg_connection *m_mqtt_bulk_connection = NULL;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool m_mqtt_ready = false;
+
+static bool m_mqtt_bulk_enabled = true;
+static bool m_mqtt_bulk_ready = false;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool m_broker = false;
+
+static bool m_ws = false;
+
+static bool m_spool = false;
+
+static size_t m_spool_budget = 0;
 
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool m_blob_raw = false;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static int m_compress = NYX_COMPRESS_NONE;
+
+static size_t m_compress_threshold = COMPRESS_THRESHOLD;
+
+static char m_compress_topic_out[64];
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool m_blob_demand = false;
+
+static uint64_t m_blob_lease_ms = 1000UL * BLOB_LEASE;
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-static nyx_x2j_ctx_t *m_x2j = NULL;
 static nyx_j2x_ctx_t *m_j2x = NULL;
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-static bool refresh = true;
+static size_t m_stats_period = STATS_PERIOD;
+
+static uint64_t m_ingress_time = 0;
+
+static int m_emit_class = -1;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    uint64_t messages;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+
+} traffic_t;
+
+static traffic_t m_traffic[NYX_METRICS_DIRECTIONS] = {0};
+
+static uint64_t m_mqtt_connects = 0;
+static uint64_t m_mqtt_bulk_connects = 0;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#ifdef NYX_TRACE
+static STR_t m_trace_file = TRACE_FILE;
+
+static volatile sig_atomic_t m_trace_dump_requested = 0;
+#endif
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool m_purge = true;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool m_realtime = false;
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
@@ -62,188 +228,197 @@ static bool streq(STR_t a, STR_t b)
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-static void json_emit(size_t len, STR_t json)
+static size_t env_size(STR_t name, size_t def)
 {
-    if(m_mqtt_connection != NULL && len > 0 && json != NULL)
+    STR_t env = getenv(name);
+
+    if(env != NULL && env[0] != '\0')
     {
-        const struct mg_mqtt_opts opts = {
-            .topic = mg_str(MQTT_TOPIC_OUT),
-            .message = mg_str_n(json, len),
-            .qos = 2,
-        };
+        str_t end;
 
-        mg_mqtt_pub(m_mqtt_connection, &opts);
+        unsigned long long val = strtoull(env, &end, 10);
 
-        MG_DEBUG(("%s", json));
+        if(*end == '\0')
+        {
+            return (size_t) val;
+        }
+
+        MG_ERROR(("Invalid value for `%s`: %s", name, env));
     }
+
+    return def;
 }
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-static void xml_emit(size_t len, STR_t xml)
+static bool env_bool(STR_t name, bool def)
 {
-    if(m_indi_connection != NULL && len > 0 && xml != NULL)
-    {
-        mg_send(m_indi_connection, xml, len);
+    STR_t env = getenv(name);
 
-        MG_DEBUG(("%s", xml));
+    if(env != NULL && env[0] != '\0')
+    {
+        return strcmp(env, "1") == 0;
     }
+
+    return def;
 }
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-static void indi_handler(struct mg_connection *connection, int ev, void *ev_data)
+#ifdef NYX_TRACE
+static void trace_signal_handler(__attribute__ ((unused)) int signum)
 {
-    /**/ if(ev == MG_EV_OPEN)
-    {
-        MG_INFO(("%lu INDI OPEN (%s)", connection->id, m_indi_url));
+    m_trace_dump_requested = 1;
+}
+#endif
 
-        m_indi_connection = connection;
-    }
-    else if(ev == MG_EV_CLOSE)
-    {
-        MG_INFO(("%lu INDI CLOSE", connection->id));
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* ONLY BLOB UPDATES GO TO THE BULK SESSION: def* / del* / OTHER set* MESSAGES OF A DEVICE KEEP THEIR ORDER           */
+/*--------------------------------------------------------------------------------------------------------------------*/
 
-        m_indi_connection = NULL;
-    }
-    else if(ev == MG_EV_ERROR)
-    {
-        MG_ERROR(("%lu INDI ERROR %s", connection->id, (STR_t) ev_data));
-    }
-    else if(ev == MG_EV_CONNECT)
-    {
-        refresh = true;
-    }
-    else if(ev == MG_EV_READ)
-    {
-        if(connection->recv.len > 0)
-        {
-            MG_DEBUG(("%.*s", connection->recv.len, (STR_t) connection->recv.buf));
+static bool is_bulk(const nyx_meta_t *meta)
+{
+    return streq(meta->tag, "setBLOBVector");
+}
 
-            nyx_x2j_feed(m_x2j, connection->recv.len, (STR_t) connection->recv.buf);
+/*--------------------------------------------------------------------------------------------------------------------*/
 
-            mg_iobuf_del(&connection->recv, 0, connection->recv.len);
+static void index_device(const nyx_meta_t *meta)
+{
+    if(m_current_upstream != NULL && meta->device != NULL && meta->device[0] != '\0')
+    {
+        /**/ if(strncmp(meta->tag, "def", 3) == 0
+                ||
+                strncmp(meta->tag, "set", 3) == 0
+        ) {
+            nyx_string_map_put(m_device_index, meta->device, m_current_upstream);
+        }
+        else if(strcmp(meta->tag, "delProperty") == 0 && (meta->name == NULL || meta->name[0] == '\0'))
+        {
+            nyx_string_map_del(m_device_index, meta->device);
         }
     }
 }
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-static void mqtt_handler(struct mg_connection *connection, int ev, void *ev_data)
+static void mqtt_publish(struct mg_connection *connection, STR_t topic, uint16_t alias, const nyx_meta_t *meta, size_t len, BUFF_t buff, uint8_t qos)
 {
-    /**/ if(ev == MG_EV_OPEN)
+    /**/ if(connection != NULL && connection == m_mqtt_connection && m_mqtt_session != NULL)
     {
-        MG_INFO(("%lu MQTT OPEN (%s)", connection->id, m_mqtt_url));
-
-        m_mqtt_connection = connection;
+        nyx_mqtt_session_pub(m_mqtt_session, connection, topic, alias, meta, len, buff, qos);
     }
-    else if(ev == MG_EV_CLOSE)
+    else if(connection != NULL)
     {
-        MG_INFO(("%lu MQTT CLOSE", connection->id));
+        nyx_mqtt_pub(connection, topic, alias, meta, len, buff, qos);
+    }
 
-        m_mqtt_connection = NULL;
+    if(m_broker)
+    {
+        nyx_broker_publish(topic, meta, len, buff);
     }
-    else if(ev == MG_EV_ERROR)
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool json_publish(size_t len, STR_t json, const nyx_meta_t *meta)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    struct mg_connection *connection = (m_mqtt_bulk_ready && is_bulk(meta)) ? m_mqtt_bulk_connection
+                                                                                 : m_mqtt_connection
+    ;
+
+    if(connection == NULL && m_broker == false)
     {
-        MG_ERROR(("%lu MQTT ERROR %s", connection->id, (STR_t) ev_data));
+        return false;
     }
-    else if(ev == MG_EV_MQTT_OPEN)
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    size_t compressed_len;
+
+    buff_t compressed = (m_compress != NYX_COMPRESS_NONE && len >= m_compress_threshold) ? nyx_compress(m_compress, &compressed_len, len, json)
+                                                                                           : NULL
+    ;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    NYX_TRACE_BEGIN("mqtt_pub");
+
+    if(compressed != NULL)
     {
-        const struct mg_mqtt_opts opts = {
-            .topic = mg_str(MQTT_TOPIC_IN),
-            .qos = 2,
-        };
+        mqtt_publish(connection, m_compress_topic_out, MQTT_ALIAS_OUT_COMPRESSED, meta, compressed_len, compressed, 2);
 
-        mg_mqtt_sub(connection, &opts);
+        nyx_memory_free(compressed);
     }
-    else if(ev == MG_EV_MQTT_MSG)
+    else
     {
-        const struct mg_mqtt_message *message = ev_data;
+        mqtt_publish(connection, MQTT_TOPIC_OUT, MQTT_ALIAS_OUT, meta, len, json, 2);
+    }
 
-        if(message->data.len > 0)
-        {
-            MG_DEBUG(("%.*s", message->data.len, (STR_t) message->data.buf));
+    NYX_TRACE_END("mqtt_pub");
 
-            nyx_j2x_feed(m_j2x, message->data.len, message->data.buf);
-        }
-    }
-}
+    /*----------------------------------------------------------------------------------------------------------------*/
 
-/*--------------------------------------------------------------------------------------------------------------------*/
+    MG_DEBUG(("%s", json));
 
-static void ping_handler(__attribute__ ((unused)) void *arg)
-{
-    if(m_mqtt_connection != NULL)
-    {
-        const struct mg_mqtt_opts opts = {
-            .topic = mg_str(MQTT_TOPIC_PING),
-            .message = mg_str(MQTT_CLIENT_NAME),
-            .qos = 0,
-        };
+    m_traffic[NYX_METRICS_INDI_TO_MQTT].bytes_out += len;
 
-        mg_mqtt_pub(m_mqtt_connection, &opts);
-    }
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return true;
 }
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-static void retry_timer_handler(__attribute__ ((unused)) void *arg)
+static void json_emit(size_t len, STR_t json, const nyx_meta_t *meta)
 {
     /*----------------------------------------------------------------------------------------------------------------*/
-    /* INDI                                                                                                           */
+
+    index_device(meta);
+
     /*----------------------------------------------------------------------------------------------------------------*/
 
-    if(m_indi_connection == NULL && m_indi_url != NULL && m_indi_url[0] != '\0')
+    if(m_ws && len > 0 && json != NULL)
     {
-        m_indi_connection = mg_connect(
-            &m_mgr,
-            m_indi_url,
-            indi_handler,
-            NULL
-        );
+        nyx_ws_publish(meta, len, json);
     }
 
-    /*----------------------------------------------------------------------------------------------------------------*/
-    /* MQTT                                                                                                           */
     /*----------------------------------------------------------------------------------------------------------------*/
 
-    if(m_mqtt_connection == NULL && m_mqtt_url != NULL && m_mqtt_url[0] != '\0')
+    if(len == 0 || json == NULL)
     {
-        m_mqtt_opts.user = mg_str(nz(m_mqtt_user));
-        m_mqtt_opts.pass = mg_str(nz(m_mqtt_pass));
-
-        m_mqtt_connection = mg_mqtt_connect(
-            &m_mgr,
-            m_mqtt_url,
-            &m_mqtt_opts,
-            mqtt_handler,
-            NULL
-        );
+        return;
     }
 
     /*----------------------------------------------------------------------------------------------------------------*/
-    /* GET PROPERTIES                                                                                                 */
+    /* THE REPLY HAS ARRIVED FROM INDISERVER, WHETHER IT IS PUBLISHED NOW OR SPOOLED                                  */
     /*----------------------------------------------------------------------------------------------------------------*/
 
-    if(refresh && m_indi_connection != NULL && m_mqtt_connection != NULL)
+    if(m_current_upstream != NULL && strncmp(meta->tag, "set", 3) == 0)
     {
-        /*------------------------------------------------------------------------------------------------------------*/
-
-        STR_t message1 = "{\"<>\":\"delINDIProperties\"}";
-
-        json_emit(strlen(message1), message1);
+        nyx_tracker_update(meta, nyx_metrics_now());
+    }
 
-        /*------------------------------------------------------------------------------------------------------------*/
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* WHILE MQTT IS DOWN, AND UNTIL WHAT WAS SPOOLED IS REPLAYED, TELEMETRY IS SPOOLED (BLOBS ARE NOT)               */
+    /*----------------------------------------------------------------------------------------------------------------*/
 
-        STR_t message2 = "<getProperties version=\"1.7\"/>";
+    if(m_spool && m_broker == false && is_bulk(meta) == false && (m_mqtt_ready == false || nyx_spool_empty() == false))
+    {
+        nyx_spool_append(meta, len, json);
 
-        xml_emit(strlen(message2), message2);
+        return;
+    }
 
-        /*------------------------------------------------------------------------------------------------------------*/
+    /*----------------------------------------------------------------------------------------------------------------*/
 
-        refresh = false;
+    if(json_publish(len, json, meta) && m_current_upstream != NULL)
+    {
+        nyx_metrics_record(NYX_METRICS_INDI_TO_MQTT, nyx_metrics_class(meta->tag), m_ingress_time);
 
-        /*------------------------------------------------------------------------------------------------------------*/
+        m_traffic[NYX_METRICS_INDI_TO_MQTT].messages++;
     }
 
     /*----------------------------------------------------------------------------------------------------------------*/
@@ -251,71 +426,1845 @@ static void retry_timer_handler(__attribute__ ((unused)) void *arg)
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void nyx_bridge_initialize()
+static void append_topic_level(str_t dst, size_t size, STR_t level)
 {
-    /*----------------------------------------------------------------------------------------------------------------*/
+    size_t len = strlen(dst);
 
-    STR_t env = getenv("NYX_VERBOSE");
+    if(len + 1 < size)
+    {
+        dst[len++] = '/';
 
-    mg_log_set(env != NULL && strcmp(env, "1") == 0 ? MG_LL_DEBUG
-                                                    : MG_LL_INFO
-    );
+        for(; *level != '\0' && len + 1 < size; level++)
+        {
+            dst[len++] = (*level == '/' || *level == '+' || *level == '#') ? '_' : *level;
+        }
 
-    /*----------------------------------------------------------------------------------------------------------------*/
+        dst[len] = '\0';
+    }
+}
 
-    mg_mgr_init(&m_mgr);
+/*--------------------------------------------------------------------------------------------------------------------*/
 
+static STR_t blob_emit(const nyx_meta_t *meta, STR_t element, size_t len, BUFF_t buff)
+{
     /*----------------------------------------------------------------------------------------------------------------*/
 
-    m_mqtt_opts.client_id = mg_str(MQTT_CLIENT_NAME);
+    struct mg_connection *connection = m_mqtt_bulk_ready ? m_mqtt_bulk_connection
+                                                         : m_mqtt_connection
+    ;
 
-    m_mqtt_opts.version = 0x04;
-    m_mqtt_opts.clean = true;
+    if(connection == NULL && m_broker == false)
+    {
+        return NULL;
+    }
 
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* TOPIC = nyx/blob/<device>/<property>/<element>                                                                 */
     /*----------------------------------------------------------------------------------------------------------------*/
 
-    m_x2j = nyx_x2j_init(json_emit);
-    m_j2x = nyx_j2x_init(xml_emit);
+    static char topic[256];
 
-    /*----------------------------------------------------------------------------------------------------------------*/
+    strcpy(topic, MQTT_TOPIC_BLOB);
 
-    m_indi_url = nyx_discover_indi_url();
+    append_topic_level(topic, sizeof(topic), meta->device);
+    append_topic_level(topic, sizeof(topic), meta->name);
+    append_topic_level(topic, sizeof(topic), element);
 
     /*----------------------------------------------------------------------------------------------------------------*/
 
-    mg_timer_add(&m_mgr, 5000UL, MG_TIMER_REPEAT | MG_TIMER_RUN_NOW, ping_handler, NULL);
+    mqtt_publish(connection, topic, 0, meta, len, buff, 2);
 
-    mg_timer_add(&m_mgr, 2000UL, MG_TIMER_REPEAT | MG_TIMER_RUN_NOW, retry_timer_handler, NULL);
+    MG_DEBUG(("%s: %lu bytes", topic, len));
 
     /*----------------------------------------------------------------------------------------------------------------*/
+
+    return topic;
 }
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void nyx_bridge_finalize()
+static void upstream_emit(const upstream_t *upstream, size_t len, STR_t xml)
 {
-    mg_mgr_free(&m_mgr);
+    if(upstream->connection != NULL && len > 0 && xml != NULL)
+    {
+        NYX_TRACE_BEGIN("indi_send");
 
-    nyx_x2j_close(m_x2j);
-    nyx_j2x_close(m_j2x);
+        mg_send(upstream->connection, xml, len);
 
-    nyx_memory_free(m_mqtt_url);
-    nyx_memory_free(m_mqtt_user);
-    nyx_memory_free(m_mqtt_pass);
+        NYX_TRACE_END("indi_send");
+
+        m_traffic[NYX_METRICS_MQTT_TO_INDI].bytes_out += len;
+
+        MG_DEBUG(("%.*s", (int) len, xml));
+    }
 }
 
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* UNTIL indiserver IS (RE)CONNECTED, COMMANDS ARE QUEUED, THE LAST ONE PER PROPERTY                                  */
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void nyx_bridge_poll(
-    STR_t mqtt_url,
-    STR_t mqtt_user,
-    STR_t mqtt_pass,
-    int ms
-) {
-    /*----------------------------------------------------------------------------------------------------------------*/
-
-    if(!streq(m_mqtt_url, mqtt_url)
-       ||
+static void upstream_command(const upstream_t *upstream, size_t len, STR_t xml, const nyx_meta_t *meta)
+{
+    /**/ if(upstream->connected)
+    {
+        upstream_emit(upstream, len, xml);
+    }
+    else if(upstream->queue != NULL)
+    {
+        nyx_queue_push(upstream->queue, m_command_seq, meta, len, xml, nyx_metrics_now());
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void upstream_flush(upstream_t *upstream)
+{
+    upstream->connected = true;
+
+    if(upstream->queue != NULL && upstream->connection != NULL)
+    {
+        m_traffic[NYX_METRICS_MQTT_TO_INDI].bytes_out += nyx_queue_flush(upstream->queue, upstream->connection, nyx_metrics_now());
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void xml_emit(size_t len, STR_t xml, const nyx_meta_t *meta)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    const upstream_t *upstream = (meta->device != NULL && meta->device[0] != '\0') ? nyx_string_map_get(m_device_index, meta->device)
+                                                                                   : NULL
+    ;
+
+    m_emit_class = nyx_metrics_class(meta->tag);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* A STREAMED COMMAND IS EMITTED AS MANY FRAGMENTS, IT IS TRACKED ONCE                                            */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(meta->tag != NULL && strncmp(meta->tag, "new", 3) == 0 && m_tracked_seq != m_command_seq)
+    {
+        nyx_tracker_command(meta, m_ingress_time);
+
+        m_tracked_seq = m_command_seq;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(upstream != NULL)
+    {
+        upstream_command(upstream, len, xml, meta);
+    }
+    else
+    {
+        for(size_t i = 0; i < m_upstream_cnt; i++)
+        {
+            upstream_command(&m_upstreams[i], len, xml, meta);
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void upstream_feed(upstream_t *upstream, size_t len, STR_t buff)
+{
+    MG_DEBUG(("%.*s", len, buff));
+
+    m_ingress_time = nyx_metrics_now();
+
+    m_traffic[NYX_METRICS_INDI_TO_MQTT].bytes_in += len;
+
+    nyx_capture_record(NYX_CAPTURE_INDI, (int) (upstream - m_upstreams), len, buff);
+
+    m_current_upstream = upstream;
+
+    NYX_TRACE_BEGIN("xml_to_json");
+
+    nyx_x2j_feed(upstream->x2j, len, buff);
+
+    NYX_TRACE_END("xml_to_json");
+
+    m_current_upstream = NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static size_t upstream_recv(upstream_t *upstream, struct mg_connection *connection)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* UNIX SOCKETS MAY CARRY SHARED BLOB FILE DESCRIPTORS (SCM_RIGHTS), WHICH RECV() WOULD SILENTLY DROP             */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    static char buff[RECV_BUFF_SIZE];
+
+    union {
+        struct cmsghdr align;
+        char buff[CMSG_SPACE(MAX_RECV_FDS * sizeof(int))];
+    } control;
+
+    struct iovec iov = {
+        .iov_base = buff,
+        .iov_len = sizeof(buff),
+    };
+
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buff,
+        .msg_controllen = sizeof(control.buff),
+    };
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    ssize_t n = recvmsg((int) (size_t) connection->fd, &msg, MSG_CMSG_CLOEXEC);
+
+    if(n <= 0)
+    {
+        if(n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        {
+            connection->is_closing = 1;
+        }
+
+        return 0;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    bool in_sync = (msg.msg_flags & MSG_CTRUNC) == 0;
+
+    for(struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        {
+            size_t fd_cnt = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+
+            for(size_t i = 0; i < fd_cnt; i++)
+            {
+                int fd;
+
+                memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+
+                in_sync = nyx_x2j_push_fd(upstream->x2j, fd) && in_sync;
+            }
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* A DROPPED DESCRIPTOR WOULD PAIR EVERY LATER SHARED BLOB WITH THE WRONG FILE: RESYNCHRONIZE BY RECONNECTING     */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(!in_sync)
+    {
+        MG_ERROR(("%lu INDI shared BLOB descriptors lost, stream out of sync", connection->id));
+
+        connection->is_closing = 1;
+
+        return 0;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    upstream_feed(upstream, (size_t) n, buff);
+
+    return (size_t) n;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void indi_handler(struct mg_connection *connection, int ev, void *ev_data)
+{
+    uint64_t start = nyx_watchdog_enter();
+
+    upstream_t *upstream = connection->fn_data;
+
+    size_t len = 0;
+
+    /**/ if(ev == MG_EV_OPEN)
+    {
+        MG_INFO(("%lu INDI OPEN (%s)", connection->id, upstream->url));
+
+        upstream->connection = connection;
+    }
+    else if(ev == MG_EV_CLOSE)
+    {
+        MG_INFO(("%lu INDI CLOSE (%s)", connection->id, upstream->url));
+
+        upstream->connection = NULL;
+
+        upstream->connected = false;
+
+        nyx_x2j_reset_fds(upstream->x2j);
+    }
+    else if(ev == MG_EV_ERROR)
+    {
+        MG_ERROR(("%lu INDI ERROR %s", connection->id, (STR_t) ev_data));
+    }
+    else if(ev == MG_EV_CONNECT)
+    {
+        upstream->refresh = true;
+
+        upstream->connects++;
+
+        upstream_flush(upstream);
+    }
+    else if(ev == MG_EV_POLL)
+    {
+        if(upstream->is_unix && connection->is_readable && connection->is_closing == 0)
+        {
+            NYX_TRACE_BEGIN("indi_handler");
+
+            len = upstream_recv(upstream, connection);
+
+            NYX_TRACE_END("indi_handler");
+
+            connection->is_readable = 0;
+        }
+    }
+    else if(ev == MG_EV_READ)
+    {
+        if(connection->recv.len > 0)
+        {
+            NYX_TRACE_BEGIN("indi_handler");
+
+            len = connection->recv.len;
+
+            upstream_feed(upstream, connection->recv.len, (STR_t) connection->recv.buf);
+
+            mg_iobuf_del(&connection->recv, 0, connection->recv.len);
+
+            NYX_TRACE_END("indi_handler");
+        }
+    }
+    else if(ev == MG_EV_WRITE)
+    {
+        NYX_TRACE_INSTANT("indi_write");
+    }
+
+    nyx_watchdog_leave(NYX_WATCHDOG_INDI, len, start);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void blob_demand_apply(STR_t device, STR_t name, STR_t policy)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    const nyx_meta_t meta = {
+        .tag = "enableBLOB",
+        .device = device,
+        .name = name,
+    };
+
+    m_command_seq++;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_string_builder_t *sb = nyx_string_builder_from(NYX_SB_NO_ESCAPE, "<enableBLOB device=\"");
+    nyx_string_builder_append(sb, NYX_SB_ESCAPE_XML, device);
+
+    if(name != NULL)
+    {
+        nyx_string_builder_append(sb, NYX_SB_NO_ESCAPE, "\" name=\"");
+        nyx_string_builder_append(sb, NYX_SB_ESCAPE_XML, name);
+    }
+
+    nyx_string_builder_append(sb, NYX_SB_NO_ESCAPE, "\">", policy, "</enableBLOB>");
+
+    str_t xml = nyx_string_builder_to_string(sb);
+    xml_emit(strlen(xml), xml, &meta);
+    nyx_memory_free(xml);
+
+    nyx_string_builder_free(sb);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    MG_INFO(("BLOBs `%s` for `%s%s%s`", policy, device, name != NULL ? "." : "", name != NULL ? name : ""));
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool blob_demand_filter(size_t len, STR_t json)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* enableBLOB COMMANDS ARE LEASES: {"<>": "enableBLOB", "@device": ..., "@name": ..., "@client": ..., "$": ...}   */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    struct mg_str obj = mg_str_n(json, len);
+
+    str_t tag = mg_json_get_str(obj, "$.<>");
+
+    if(tag == NULL || strcmp(tag, "enableBLOB") != 0)
+    {
+        mg_free(tag);
+
+        return false;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    str_t device = mg_json_get_str(obj, "$.@device");
+    str_t name = mg_json_get_str(obj, "$.@name");
+    str_t client = mg_json_get_str(obj, "$.@client");
+    str_t policy = mg_json_get_str(obj, "$.$");
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* WITHOUT A DEVICE OR A VALID POLICY, THE COMMAND IS NOT A LEASE AND IS FORWARDED UNCHANGED                      */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    bool result = device != NULL && device[0] != '\0'
+                  &&
+                  policy != NULL && (strcmp(policy, "Never") == 0 || strcmp(policy, "Also") == 0 || strcmp(policy, "Only") == 0)
+    ;
+
+    if(result)
+    {
+        nyx_blob_demand_update(
+            device,
+            name,
+            client != NULL ? client : "",
+            policy,
+            mg_millis() + m_blob_lease_ms
+        );
+    }
+
+    mg_free(tag);
+    mg_free(device);
+    mg_free(name);
+    mg_free(client);
+    mg_free(policy);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return result;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void command_feed(size_t len, STR_t json)
+{
+    MG_DEBUG(("%.*s", len, json));
+
+    nyx_capture_record(NYX_CAPTURE_MQTT, 0, len, json);
+
+    m_emit_class = -1;
+
+    NYX_TRACE_BEGIN("json_to_xml");
+
+    m_command_seq++;
+
+    if(m_blob_demand == false || blob_demand_filter(len, json) == false)
+    {
+        nyx_j2x_feed(m_j2x, len, json);
+    }
+
+    NYX_TRACE_END("json_to_xml");
+
+    if(m_emit_class >= 0)
+    {
+        nyx_metrics_record(NYX_METRICS_MQTT_TO_INDI, m_emit_class, m_ingress_time);
+
+        m_traffic[NYX_METRICS_MQTT_TO_INDI].messages++;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void command_message(size_t topic_len, STR_t topic, size_t len, STR_t data)
+{
+    NYX_TRACE_BEGIN("mqtt_handler");
+
+    m_ingress_time = nyx_metrics_now();
+
+    m_traffic[NYX_METRICS_MQTT_TO_INDI].bytes_in += len;
+
+    if(len > 0)
+    {
+        /*------------------------------------------------------------------------------------------------------------*/
+        /* COMPRESSED COMMANDS COME ON nyx/cmd/json/<algorithm>                                                       */
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        if(topic_len > sizeof(MQTT_TOPIC_IN))
+        {
+            char algo_name[16];
+
+            mg_snprintf(algo_name, sizeof(algo_name), "%.*s", (int) (topic_len - sizeof(MQTT_TOPIC_IN)), topic + sizeof(MQTT_TOPIC_IN));
+
+            int algo = nyx_compress_parse(algo_name);
+
+            size_t json_len;
+
+            str_t json = algo > NYX_COMPRESS_NONE ? nyx_decompress(algo, &json_len, len, data)
+                                                  : NULL
+            ;
+
+            if(json != NULL)
+            {
+                command_feed(json_len, json);
+
+                nyx_memory_free(json);
+            }
+            else
+            {
+                MG_ERROR(("Cannot decompress message on `%.*s`", (int) topic_len, topic));
+            }
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+        /* PLAIN COMMANDS                                                                                             */
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        else
+        {
+            command_feed(len, data);
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+    }
+
+    NYX_TRACE_END("mqtt_handler");
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void broker_message(size_t topic_len, STR_t topic, size_t len, BUFF_t buff)
+{
+    struct mg_str str = mg_str_n(topic, topic_len);
+
+    if(mg_match(str, mg_str(MQTT_TOPIC_IN), NULL) || mg_match(str, mg_str(MQTT_TOPIC_IN "/*"), NULL))
+    {
+        command_message(topic_len, topic, len, buff);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void mqtt_session_start(struct mg_connection *connection, bool present)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* A RESUMED SESSION KEEPS ITS SUBSCRIPTIONS, AND THE BROKER DELIVERS THE COMMANDS QUEUED MEANWHILE               */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(m_mqtt_session != NULL)
+    {
+        nyx_mqtt_session_resume(m_mqtt_session, connection, present);
+    }
+
+    if(present)
+    {
+        return;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    const struct mg_mqtt_opts opts1 = {
+        .topic = mg_str(MQTT_TOPIC_IN),
+        .qos = 2,
+    };
+
+    mg_mqtt_sub(connection, &opts1);
+
+    const struct mg_mqtt_opts opts2 = {
+        .topic = mg_str(MQTT_TOPIC_IN "/+"),
+        .qos = 2,
+    };
+
+    mg_mqtt_sub(connection, &opts2);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void mqtt_handler(struct mg_connection *connection, int ev, void *ev_data)
+{
+    uint64_t start = nyx_watchdog_enter();
+
+    size_t len = 0;
+
+    /**/ if(ev == MG_EV_OPEN)
+    {
+        MG_INFO(("%lu MQTT OPEN (%s)", connection->id, m_mqtt_url));
+
+        m_mqtt_connection = connection;
+    }
+    else if(ev == MG_EV_CLOSE)
+    {
+        MG_INFO(("%lu MQTT CLOSE", connection->id));
+
+        m_mqtt_connection = NULL;
+
+        m_mqtt_ready = false;
+    }
+    else if(ev == MG_EV_ERROR)
+    {
+        MG_ERROR(("%lu MQTT ERROR %s", connection->id, (STR_t) ev_data));
+    }
+    else if(ev == MG_EV_MQTT_OPEN)
+    {
+        m_mqtt_connects++;
+
+        m_mqtt_ready = *(const uint8_t *) ev_data == 0;
+    }
+    else if(ev == MG_EV_MQTT_CMD)
+    {
+        const struct mg_mqtt_message *message = ev_data;
+
+        if(message->cmd == MQTT_CMD_CONNACK)
+        {
+            bool present = nyx_mqtt_open(connection, message);
+
+            if(message->ack == 0)
+            {
+                mqtt_session_start(connection, present);
+            }
+        }
+        else
+        {
+            nyx_mqtt_ack(connection, message);
+
+            if(m_mqtt_session != NULL)
+            {
+                nyx_mqtt_session_ack(m_mqtt_session, message);
+            }
+        }
+    }
+    else if(ev == MG_EV_WRITE)
+    {
+        NYX_TRACE_INSTANT("mqtt_write");
+    }
+    else if(ev == MG_EV_MQTT_MSG)
+    {
+        const struct mg_mqtt_message *message = ev_data;
+
+        len = message->data.len;
+
+        if(m_mqtt_session == NULL || nyx_mqtt_session_accept(m_mqtt_session, message))
+        {
+            command_message(message->topic.len, message->topic.buf, message->data.len, message->data.buf);
+        }
+    }
+
+    nyx_watchdog_leave(NYX_WATCHDOG_MQTT, len, start);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void mqtt_bulk_handler(struct mg_connection *connection, int ev, void *ev_data)
+{
+    uint64_t start = nyx_watchdog_enter();
+
+    /**/ if(ev == MG_EV_OPEN)
+    {
+        MG_INFO(("%lu MQTT BULK OPEN (%s)", connection->id, m_mqtt_url));
+
+        m_mqtt_bulk_connection = connection;
+    }
+    else if(ev == MG_EV_CLOSE)
+    {
+        MG_INFO(("%lu MQTT BULK CLOSE", connection->id));
+
+        m_mqtt_bulk_connection = NULL;
+
+        m_mqtt_bulk_ready = false;
+    }
+    else if(ev == MG_EV_ERROR)
+    {
+        MG_ERROR(("%lu MQTT BULK ERROR %s", connection->id, (STR_t) ev_data));
+    }
+    else if(ev == MG_EV_MQTT_OPEN)
+    {
+        m_mqtt_bulk_ready = *(const uint8_t *) ev_data == 0;
+
+        m_mqtt_bulk_connects++;
+    }
+    else if(ev == MG_EV_MQTT_CMD)
+    {
+        const struct mg_mqtt_message *message = ev_data;
+
+        if(message->cmd == MQTT_CMD_CONNACK)
+        {
+            nyx_mqtt_open(connection, message);
+        }
+        else
+        {
+            nyx_mqtt_ack(connection, message);
+        }
+    }
+    else if(ev == MG_EV_WRITE)
+    {
+        NYX_TRACE_INSTANT("mqtt_bulk_write");
+    }
+
+    nyx_watchdog_leave(NYX_WATCHDOG_MQTT_BULK, 0, start);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void ping_handler(__attribute__ ((unused)) void *arg)
+{
+    uint64_t start = nyx_watchdog_enter();
+
+    if(m_mqtt_connection != NULL || m_broker)
+    {
+        mqtt_publish(m_mqtt_connection, MQTT_TOPIC_PING, 0, NULL, strlen(MQTT_CLIENT_NAME), MQTT_CLIENT_NAME, 0);
+    }
+
+    nyx_watchdog_leave(NYX_WATCHDOG_PING, 0, start);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void spool_message(const nyx_meta_t *meta, size_t len, STR_t json)
+{
+    json_publish(len, json, meta);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void spool_handler(__attribute__ ((unused)) void *arg)
+{
+    uint64_t start = nyx_watchdog_enter();
+
+    size_t len = 0;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* REPLAY AT MOST NYX_SPOOL_RATE, AND ONLY ONCE THE BROKER HAS READ THE PREVIOUS BATCH                            */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(m_mqtt_ready && m_mqtt_connection != NULL && m_mqtt_connection->send.len < m_spool_budget)
+    {
+        len = nyx_spool_replay(m_spool_budget, spool_message);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_watchdog_leave(NYX_WATCHDOG_SPOOL, len, start);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void stats_handler(__attribute__ ((unused)) void *arg)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint64_t start = nyx_watchdog_enter();
+
+    nyx_metrics_rotate();
+
+    nyx_watchdog_rotate();
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(m_mqtt_connection != NULL || m_broker)
+    {
+        nyx_metrics_t metrics;
+
+        nyx_metrics_snapshot(&metrics);
+
+        str_t json = nyx_metrics_to_json(&metrics);
+
+        mqtt_publish(m_mqtt_connection, MQTT_TOPIC_STATS, 0, NULL, strlen(json), json, 0);
+
+        nyx_memory_free(json);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_watchdog_leave(NYX_WATCHDOG_STATS, 0, start);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* HTTP METRICS (PROMETHEUS TEXT EXPOSITION FORMAT)                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+__attribute__ ((format(printf, 2, 3))) static void prom_append(nyx_string_builder_t *sb, STR_t fmt, ...)
+{
+    char buff[512];
+
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buff, sizeof(buff), fmt, ap);
+    va_end(ap);
+
+    nyx_string_builder_append(sb, NYX_SB_NO_ESCAPE, buff);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void prom_header(nyx_string_builder_t *sb, STR_t name, STR_t type, STR_t help)
+{
+    prom_append(sb, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void prom_int(nyx_string_builder_t *sb, STR_t name, STR_t labels, uint64_t value)
+{
+    prom_append(sb, "%s{%s} %llu\n", name, labels, (unsigned long long) value);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void prom_seconds(nyx_string_builder_t *sb, STR_t name, STR_t labels, uint64_t us)
+{
+    prom_append(sb, "%s{%s} %.6f\n", name, labels, 1.0e-6 * (double) us);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void prom_escape(str_t dst, size_t size, STR_t src)
+{
+    size_t i = 0;
+
+    for(; *src != '\0' && i + 2 < size; src++)
+    {
+        /**/ if(*src == '\\' || *src == '"') {
+            dst[i++] = '\\';
+            dst[i++] = *src;
+        }
+        else if(*src == '\n') {
+            dst[i++] = '\\';
+            dst[i++] = 'n';
+        }
+        else {
+            dst[i++] = *src;
+        }
+    }
+
+    dst[i] = '\0';
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    nyx_string_builder_t *sb;
+
+    STR_t name;
+
+} prom_tracker_ctx_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void prom_tracker_entry(const nyx_tracker_entry_t *entry, buff_t arg)
+{
+    const prom_tracker_ctx_t *ctx = arg;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    char device[2 * sizeof(entry->device)];
+    char property[2 * sizeof(entry->name)];
+    char labels[512];
+
+    prom_escape(device, sizeof(device), entry->device);
+    prom_escape(property, sizeof(property), entry->name);
+
+    int n = snprintf(labels, sizeof(labels), "device=\"%s\",property=\"%s\"", device, property);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    /**/ if(strcmp(ctx->name, "nyx_commands_total") == 0) {
+        prom_int(ctx->sb, ctx->name, labels, entry->commands);
+    }
+    else if(strcmp(ctx->name, "nyx_command_timeouts_total") == 0) {
+        prom_int(ctx->sb, ctx->name, labels, entry->timeouts);
+    }
+    else if(strcmp(ctx->name, "nyx_command_stalls_total") == 0) {
+        prom_int(ctx->sb, ctx->name, labels, entry->stalls);
+    }
+    else if(strcmp(ctx->name, "nyx_command_alerts_total") == 0) {
+        prom_int(ctx->sb, ctx->name, labels, entry->alerts);
+    }
+    else
+    {
+        const nyx_hist_t *hist = strcmp(ctx->name, "nyx_command_ack_seconds") == 0 ? &entry->ack : &entry->done;
+
+        char name[64];
+
+        snprintf(name, sizeof(name), "%s_count", ctx->name);
+        prom_int(ctx->sb, name, labels, hist->count);
+
+        snprintf(name, sizeof(name), "%s_sum", ctx->name);
+        prom_seconds(ctx->sb, name, labels, hist->sum);
+
+        snprintf(labels + n, sizeof(labels) - (size_t) n, ",quantile=\"0.5\"");
+        prom_seconds(ctx->sb, ctx->name, labels, nyx_hist_quantile(hist, 0.50));
+
+        snprintf(labels + n, sizeof(labels) - (size_t) n, ",quantile=\"0.99\"");
+        prom_seconds(ctx->sb, ctx->name, labels, nyx_hist_quantile(hist, 0.99));
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static str_t metrics_exposition(void)
+{
+    nyx_string_builder_t *sb = nyx_string_builder_new();
+
+    char labels[256];
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* TRAFFIC                                                                                                        */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    static STR_t directions[NYX_METRICS_DIRECTIONS] = {
+        [NYX_METRICS_INDI_TO_MQTT] = "indi_to_mqtt",
+        [NYX_METRICS_MQTT_TO_INDI] = "mqtt_to_indi",
+    };
+
+    prom_header(sb, "nyx_messages_total", "counter", "Converted messages.");
+
+    for(int i = 0; i < NYX_METRICS_DIRECTIONS; i++)
+    {
+        snprintf(labels, sizeof(labels), "direction=\"%s\"", directions[i]);
+
+        prom_int(sb, "nyx_messages_total", labels, m_traffic[i].messages);
+    }
+
+    prom_header(sb, "nyx_received_bytes_total", "counter", "Bytes received, before conversion.");
+
+    for(int i = 0; i < NYX_METRICS_DIRECTIONS; i++)
+    {
+        snprintf(labels, sizeof(labels), "direction=\"%s\"", directions[i]);
+
+        prom_int(sb, "nyx_received_bytes_total", labels, m_traffic[i].bytes_in);
+    }
+
+    prom_header(sb, "nyx_sent_bytes_total", "counter", "Bytes sent, after conversion.");
+
+    for(int i = 0; i < NYX_METRICS_DIRECTIONS; i++)
+    {
+        snprintf(labels, sizeof(labels), "direction=\"%s\"", directions[i]);
+
+        prom_int(sb, "nyx_sent_bytes_total", labels, m_traffic[i].bytes_out);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* CONVERSION LATENCY                                                                                             */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    const nyx_metrics_t *metrics = nyx_metrics_cumulative();
+
+    prom_header(sb, "nyx_latency_seconds", "summary", "Time from receive to send, by message type.");
+
+    for(int i = 0; i < NYX_METRICS_DIRECTIONS; i++)
+    {
+        for(int j = 0; j < NYX_METRICS_CLASSES; j++)
+        {
+            const nyx_hist_t *hist = &metrics->hist[i][j];
+
+            STR_t type = nyx_metrics_class_name(j);
+
+            int n = snprintf(labels, sizeof(labels), "direction=\"%s\",type=\"%s\"", directions[i], type);
+
+            prom_int(sb, "nyx_latency_seconds_count", labels, hist->count);
+            prom_seconds(sb, "nyx_latency_seconds_sum", labels, hist->sum);
+
+            snprintf(labels + n, sizeof(labels) - (size_t) n, ",quantile=\"0.5\"");
+            prom_seconds(sb, "nyx_latency_seconds", labels, nyx_hist_quantile(hist, 0.50));
+
+            snprintf(labels + n, sizeof(labels) - (size_t) n, ",quantile=\"0.99\"");
+            prom_seconds(sb, "nyx_latency_seconds", labels, nyx_hist_quantile(hist, 0.99));
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* COMMAND ROUND TRIPS                                                                                            */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    static STR_t tracker_metrics[][3] = {
+        {"nyx_commands_total", "counter", "Commands sent to the property."},
+        {"nyx_command_ack_seconds", "summary", "Time from command to the first update."},
+        {"nyx_command_completion_seconds", "summary", "Time from command to the first non-Busy update."},
+        {"nyx_command_timeouts_total", "counter", "Commands not answered within NYX_COMMAND_TIMEOUT."},
+        {"nyx_command_stalls_total", "counter", "Commands answered but not completed within NYX_COMMAND_TIMEOUT."},
+        {"nyx_command_alerts_total", "counter", "Commands completed in the Alert state."},
+    };
+
+    for(size_t i = 0; i < sizeof(tracker_metrics) / sizeof(tracker_metrics[0]); i++)
+    {
+        prom_tracker_ctx_t ctx = {
+            .sb = sb,
+            .name = tracker_metrics[i][0],
+        };
+
+        prom_header(sb, tracker_metrics[i][0], tracker_metrics[i][1], tracker_metrics[i][2]);
+
+        nyx_tracker_foreach(prom_tracker_entry, &ctx);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* INDI UPSTREAMS                                                                                                 */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    prom_header(sb, "nyx_indi_connected", "gauge", "Whether the indiserver connection is up.");
+
+    for(size_t i = 0; i < m_upstream_cnt; i++)
+    {
+        snprintf(labels, sizeof(labels), "url=\"%s\"", m_upstreams[i].url);
+
+        prom_int(sb, "nyx_indi_connected", labels, m_upstreams[i].connection != NULL);
+    }
+
+    prom_header(sb, "nyx_indi_connects_total", "counter", "indiserver (re)connections.");
+
+    for(size_t i = 0; i < m_upstream_cnt; i++)
+    {
+        snprintf(labels, sizeof(labels), "url=\"%s\"", m_upstreams[i].url);
+
+        prom_int(sb, "nyx_indi_connects_total", labels, m_upstreams[i].connects);
+    }
+
+    prom_header(sb, "nyx_indi_send_queue_bytes", "gauge", "Bytes waiting in the indiserver send buffer.");
+
+    for(size_t i = 0; i < m_upstream_cnt; i++)
+    {
+        const struct mg_connection *connection = m_upstreams[i].connection;
+
+        snprintf(labels, sizeof(labels), "url=\"%s\"", m_upstreams[i].url);
+
+        prom_int(sb, "nyx_indi_send_queue_bytes", labels, connection != NULL ? connection->send.len : 0);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* INDI COMMAND QUEUES                                                                                            */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    static STR_t queue_metrics[][3] = {
+        {"nyx_indi_queue_commands", "gauge", "Commands waiting for the indiserver connection."},
+        {"nyx_indi_queued_commands_total", "counter", "Commands queued while indiserver was disconnected."},
+        {"nyx_indi_conflated_commands_total", "counter", "Queued commands replaced by a newer one for the same property."},
+        {"nyx_indi_expired_commands_total", "counter", "Queued commands dropped as too old or by a full queue."},
+    };
+
+    for(size_t i = 0; i < sizeof(queue_metrics) / sizeof(queue_metrics[0]); i++)
+    {
+        prom_header(sb, queue_metrics[i][0], queue_metrics[i][1], queue_metrics[i][2]);
+
+        for(size_t j = 0; j < m_upstream_cnt; j++)
+        {
+            nyx_queue_stats_t stats = {0};
+
+            if(m_upstreams[j].queue != NULL)
+            {
+                nyx_queue_get_stats(m_upstreams[j].queue, &stats);
+            }
+
+            const uint64_t values[4] = {stats.size, stats.queued, stats.conflated, stats.expired};
+
+            snprintf(labels, sizeof(labels), "url=\"%s\"", m_upstreams[j].url);
+
+            prom_int(sb, queue_metrics[i][0], labels, values[i]);
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* MQTT SESSIONS                                                                                                  */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    const struct mg_connection *connections[2] = {m_mqtt_connection, m_mqtt_bulk_connection};
+
+    const uint64_t connects[2] = {m_mqtt_connects, m_mqtt_bulk_connects};
+
+    static STR_t sessions[2] = {"session=\"main\"", "session=\"bulk\""};
+
+    prom_header(sb, "nyx_mqtt_connects_total", "counter", "MQTT (re)connections.");
+
+    for(int i = 0; i < 2; i++) {
+        prom_int(sb, "nyx_mqtt_connects_total", sessions[i], connects[i]);
+    }
+
+    prom_header(sb, "nyx_mqtt_send_queue_bytes", "gauge", "Bytes waiting in the MQTT send buffer.");
+
+    for(int i = 0; i < 2; i++) {
+        prom_int(sb, "nyx_mqtt_send_queue_bytes", sessions[i], connections[i] != NULL ? connections[i]->send.len : 0);
+    }
+
+    prom_header(sb, "nyx_mqtt_inflight_messages", "gauge", "QoS 1 / 2 messages published but not yet acknowledged.");
+
+    for(int i = 0; i < 2; i++) {
+        uint32_t inflight = connections[i] != NULL ? nyx_mqtt_inflight(connections[i]) : 0;
+
+        prom_int(sb, "nyx_mqtt_inflight_messages", sessions[i], inflight);
+    }
+
+    nyx_mqtt_session_stats_t session_stats;
+
+    memset(&session_stats, 0x00, sizeof(session_stats));
+
+    if(m_mqtt_session != NULL)
+    {
+        nyx_mqtt_session_get_stats(m_mqtt_session, &session_stats);
+    }
+
+    prom_header(sb, "nyx_mqtt_session_inflight_messages", "gauge", "QoS 1 / 2 messages tracked by the persistent session until acknowledged.");
+    prom_int(sb, "nyx_mqtt_session_inflight_messages", "", session_stats.inflight);
+
+    prom_header(sb, "nyx_mqtt_retransmitted_total", "counter", "Unacknowledged messages resent after a reconnection.");
+    prom_int(sb, "nyx_mqtt_retransmitted_total", "", session_stats.retransmitted);
+
+    prom_header(sb, "nyx_mqtt_untracked_total", "counter", "QoS 1 / 2 messages published without tracking because the session was full.");
+    prom_int(sb, "nyx_mqtt_untracked_total", "", session_stats.untracked);
+
+    prom_header(sb, "nyx_mqtt_duplicates_total", "counter", "Redelivered QoS 2 commands ignored.");
+    prom_int(sb, "nyx_mqtt_duplicates_total", "", session_stats.duplicates);
+
+    prom_header(sb, "nyx_broker_clients", "gauge", "Clients connected to the embedded broker.");
+    prom_int(sb, "nyx_broker_clients", "", nyx_broker_clients());
+
+    prom_header(sb, "nyx_broker_dropped_total", "counter", "Messages not delivered to a client of the embedded broker whose send buffer was full.");
+    prom_int(sb, "nyx_broker_dropped_total", "", nyx_broker_dropped());
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* WEBSOCKET                                                                                                      */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    prom_header(sb, "nyx_ws_clients", "gauge", "WebSocket clients connected to /ws.");
+    prom_int(sb, "nyx_ws_clients", "", nyx_ws_clients());
+
+    prom_header(sb, "nyx_ws_dropped_total", "counter", "Messages not sent to a WebSocket client whose send queue was full.");
+    prom_int(sb, "nyx_ws_dropped_total", "", nyx_ws_dropped());
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* SPOOL                                                                                                          */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_spool_stats_t spool;
+
+    memset(&spool, 0x00, sizeof(spool));
+
+    nyx_spool_get_stats(&spool);
+
+    prom_header(sb, "nyx_spool_messages", "gauge", "Messages waiting in the spool.");
+    prom_int(sb, "nyx_spool_messages", "", spool.messages);
+
+    prom_header(sb, "nyx_spool_bytes", "gauge", "Bytes used in the spool.");
+    prom_int(sb, "nyx_spool_bytes", "", spool.bytes);
+
+    prom_header(sb, "nyx_spool_spooled_total", "counter", "Messages spooled while MQTT was down.");
+    prom_int(sb, "nyx_spool_spooled_total", "", spool.spooled);
+
+    prom_header(sb, "nyx_spool_replayed_total", "counter", "Spooled messages published after the reconnection.");
+    prom_int(sb, "nyx_spool_replayed_total", "", spool.replayed);
+
+    prom_header(sb, "nyx_spool_evicted_total", "counter", "Spooled messages overwritten by newer ones because the spool was full.");
+    prom_int(sb, "nyx_spool_evicted_total", "", spool.evicted);
+
+    prom_header(sb, "nyx_spool_rejected_total", "counter", "Messages too large to be spooled.");
+    prom_int(sb, "nyx_spool_rejected_total", "", spool.rejected);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* EVENT LOOP                                                                                                     */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    const nyx_watchdog_t *watchdog = nyx_watchdog_cumulative();
+
+    prom_header(sb, "nyx_loop_iteration_seconds", "summary", "Busy time of an event loop iteration, idle wait excluded.");
+
+    prom_int(sb, "nyx_loop_iteration_seconds_count", "", watchdog->iteration.count);
+    prom_seconds(sb, "nyx_loop_iteration_seconds_sum", "", watchdog->iteration.sum);
+    prom_seconds(sb, "nyx_loop_iteration_seconds", "quantile=\"0.5\"", nyx_hist_quantile(&watchdog->iteration, 0.50));
+    prom_seconds(sb, "nyx_loop_iteration_seconds", "quantile=\"0.99\"", nyx_hist_quantile(&watchdog->iteration, 0.99));
+    prom_seconds(sb, "nyx_loop_iteration_seconds", "quantile=\"1\"", watchdog->iteration.max);
+
+    prom_header(sb, "nyx_loop_handler_seconds", "summary", "Time spent in an event loop callback, by handler.");
+
+    for(int i = 0; i < NYX_WATCHDOG_HANDLERS; i++)
+    {
+        const nyx_hist_t *hist = &watchdog->handler[i];
+
+        int n = snprintf(labels, sizeof(labels), "handler=\"%s\"", nyx_watchdog_handler_name(i));
+
+        prom_int(sb, "nyx_loop_handler_seconds_count", labels, hist->count);
+        prom_seconds(sb, "nyx_loop_handler_seconds_sum", labels, hist->sum);
+
+        snprintf(labels + n, sizeof(labels) - (size_t) n, ",quantile=\"0.99\"");
+        prom_seconds(sb, "nyx_loop_handler_seconds", labels, nyx_hist_quantile(hist, 0.99));
+
+        snprintf(labels + n, sizeof(labels) - (size_t) n, ",quantile=\"1\"");
+        prom_seconds(sb, "nyx_loop_handler_seconds", labels, hist->max);
+    }
+
+    prom_header(sb, "nyx_loop_stalls_total", "counter", "Event loop iterations over NYX_STALL_BUDGET.");
+    prom_int(sb, "nyx_loop_stalls_total", "", watchdog->stalls);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* BRIDGE THREAD                                                                                                  */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_realtime_stats_t realtime;
+
+    nyx_realtime_get_stats(&realtime);
+
+    prom_header(sb, "nyx_thread_realtime", "gauge", "Whether the real-time profile was fully applied.");
+    prom_int(sb, "nyx_thread_realtime", "", m_realtime);
+
+    prom_header(sb, "nyx_thread_page_faults_total", "counter", "Page faults taken by the bridge thread.");
+    prom_int(sb, "nyx_thread_page_faults_total", "type=\"minor\"", realtime.minor_faults);
+    prom_int(sb, "nyx_thread_page_faults_total", "type=\"major\"", realtime.major_faults);
+
+    prom_header(sb, "nyx_thread_context_switches_total", "counter", "Context switches of the bridge thread.");
+    prom_int(sb, "nyx_thread_context_switches_total", "type=\"voluntary\"", realtime.voluntary_switches);
+    prom_int(sb, "nyx_thread_context_switches_total", "type=\"involuntary\"", realtime.involuntary_switches);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* ALLOCATOR                                                                                                      */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_memory_stats_t memory;
+
+    nyx_memory_get_stats(&memory);
+
+    prom_header(sb, "nyx_memory_allocations_total", "counter", "Bridge heap allocations.");
+    prom_int(sb, "nyx_memory_allocations_total", "", memory.allocs);
+
+    prom_header(sb, "nyx_memory_frees_total", "counter", "Bridge heap releases.");
+    prom_int(sb, "nyx_memory_frees_total", "", memory.frees);
+
+    prom_header(sb, "nyx_memory_allocated_bytes_total", "counter", "Bytes requested from the heap by the bridge.");
+    prom_int(sb, "nyx_memory_allocated_bytes_total", "", memory.bytes);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    str_t result = nyx_string_builder_to_string(sb);
+
+    nyx_string_builder_free(sb);
+
+    return result;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void http_handler(struct mg_connection *connection, int ev, void *ev_data)
+{
+    uint64_t start = nyx_watchdog_enter();
+
+    size_t len = 0;
+
+    if(ev == MG_EV_HTTP_MSG)
+    {
+        const struct mg_http_message *message = ev_data;
+
+        len = message->message.len;
+
+        if(mg_match(message->uri, mg_str("/metrics"), NULL))
+        {
+            str_t body = metrics_exposition();
+
+            mg_http_reply(connection, 200, "Content-Type: text/plain; version=0.0.4\r\n", "%s", body);
+
+            nyx_memory_free(body);
+        }
+        else if(m_ws && mg_match(message->uri, mg_str("/ws"), NULL))
+        {
+            mg_ws_upgrade(connection, ev_data, NULL);
+
+            if(connection->is_websocket)
+            {
+                nyx_ws_open(connection, message->query.len, message->query.buf);
+            }
+        }
+#ifdef NYX_TRACE
+        else if(mg_match(message->uri, mg_str("/trace"), NULL))
+        {
+            str_t body = nyx_trace_dump();
+
+            mg_http_reply(connection, 200, "Content-Type: application/json\r\n", "%s", body);
+
+            nyx_memory_free(body);
+        }
+#endif
+        else
+        {
+            mg_http_reply(connection, 404, "", "Not found\n");
+        }
+    }
+    else if(ev == MG_EV_CLOSE)
+    {
+        nyx_ws_close(connection);
+    }
+
+    nyx_watchdog_leave(NYX_WATCHDOG_HTTP, len, start);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void upstream_connect(upstream_t *upstream)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* UNIX SOCKET                                                                                                    */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    upstream->is_unix = strncmp(upstream->url, "unix://", 7) == 0;
+
+    if(upstream->is_unix)
+    {
+        int fd = nyx_unix_connect(upstream->url + 7);
+
+        if(fd < 0)
+        {
+            MG_ERROR(("Cannot connect to %s", upstream->url));
+
+            return;
+        }
+
+        /* mongoose does not fire MG_EV_CONNECT for wrapped descriptors */
+
+        if(mg_wrapfd(&m_mgr, fd, indi_handler, upstream) != NULL)
+        {
+            upstream->refresh = true;
+
+            upstream->connects++;
+
+            upstream_flush(upstream);
+        }
+        else
+        {
+            close(fd);
+        }
+
+        return;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* TCP                                                                                                            */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    mg_connect(
+        &m_mgr,
+        upstream->url,
+        indi_handler,
+        upstream
+    );
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool purge_device(STR_t device, buff_t value, buff_t arg)
+{
+    if(value == arg)
+    {
+        const nyx_meta_t meta = {
+            .tag = "delProperty",
+            .device = device,
+        };
+
+        nyx_string_builder_t *sb = nyx_string_builder_from(NYX_SB_NO_ESCAPE, "{\"<>\":\"delProperty\",\"@device\":\"");
+        nyx_string_builder_append(sb, NYX_SB_ESCAPE_JSON, device);
+        nyx_string_builder_append(sb, NYX_SB_NO_ESCAPE, "\"}");
+
+        str_t message = nyx_string_builder_to_string(sb);
+        json_emit(strlen(message), message, &meta);
+        nyx_memory_free(message);
+
+        nyx_string_builder_free(sb);
+
+        return true;
+    }
+
+    return false;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void retry_timer_handler(__attribute__ ((unused)) void *arg)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint64_t start = nyx_watchdog_enter();
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* INDI                                                                                                           */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    for(size_t i = 0; i < m_upstream_cnt; i++)
+    {
+        upstream_t *upstream = &m_upstreams[i];
+
+        if(upstream->connection == NULL)
+        {
+            upstream_connect(upstream);
+        }
+
+        if(upstream->queue != NULL)
+        {
+            nyx_queue_expire(upstream->queue, nyx_metrics_now());
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* MQTT                                                                                                           */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(m_broker == false && m_mqtt_connection == NULL && m_mqtt_url != NULL && m_mqtt_url[0] != '\0')
+    {
+        m_mqtt_opts.client_id = mg_str(MQTT_CLIENT_NAME);
+
+        m_mqtt_opts.user = mg_str(nz(m_mqtt_user));
+        m_mqtt_opts.pass = mg_str(nz(m_mqtt_pass));
+
+        m_mqtt_opts.clean = m_mqtt_session == NULL;
+
+        m_mqtt_opts.props = m_mqtt_session != NULL ? &m_mqtt_session_prop : NULL;
+        m_mqtt_opts.num_props = m_mqtt_session != NULL ? 1 : 0;
+
+        m_mqtt_connection = mg_mqtt_connect(
+            &m_mgr,
+            m_mqtt_url,
+            &m_mqtt_opts,
+            mqtt_handler,
+            NULL
+        );
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* MQTT BULK                                                                                                      */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(m_broker == false && m_mqtt_bulk_enabled && m_mqtt_bulk_connection == NULL && m_mqtt_url != NULL && m_mqtt_url[0] != '\0')
+    {
+        m_mqtt_opts.client_id = mg_str(MQTT_CLIENT_NAME_BULK);
+
+        m_mqtt_opts.user = mg_str(nz(m_mqtt_user));
+        m_mqtt_opts.pass = mg_str(nz(m_mqtt_pass));
+
+        m_mqtt_opts.clean = true;
+
+        m_mqtt_opts.props = NULL;
+        m_mqtt_opts.num_props = 0;
+
+        m_mqtt_bulk_connection = mg_mqtt_connect(
+            &m_mgr,
+            m_mqtt_url,
+            &m_mqtt_opts,
+            mqtt_bulk_handler,
+            NULL
+        );
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* GET PROPERTIES                                                                                                 */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(m_mqtt_connection != NULL || m_broker)
+    {
+        for(size_t i = 0; i < m_upstream_cnt; i++)
+        {
+            upstream_t *upstream = &m_upstreams[i];
+
+            if(upstream->refresh && upstream->connection != NULL)
+            {
+                /*----------------------------------------------------------------------------------------------------*/
+
+                if(m_purge)
+                {
+                    const nyx_meta_t meta = {
+                        .tag = "delINDIProperties",
+                    };
+
+                    STR_t message = "{\"<>\":\"delINDIProperties\"}";
+
+                    json_emit(strlen(message), message, &meta);
+
+                    m_purge = false;
+                }
+                else
+                {
+                    nyx_string_map_foreach(m_device_index, purge_device, upstream);
+                }
+
+                /*----------------------------------------------------------------------------------------------------*/
+
+                STR_t message = "<getProperties version=\"1.7\"/>";
+
+                upstream_emit(upstream, strlen(message), message);
+
+                /*----------------------------------------------------------------------------------------------------*/
+
+                if(m_blob_demand)
+                {
+                    nyx_blob_demand_replay();
+                }
+
+                /*----------------------------------------------------------------------------------------------------*/
+
+                upstream->refresh = false;
+
+                /*----------------------------------------------------------------------------------------------------*/
+            }
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* BLOB LEASES                                                                                                    */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(m_blob_demand)
+    {
+        nyx_blob_demand_expire(mg_millis());
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* UNANSWERED COMMANDS                                                                                            */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_tracker_expire(nyx_metrics_now());
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* CAPTURE                                                                                                        */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_capture_flush();
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* SPOOL                                                                                                          */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(m_spool)
+    {
+        nyx_spool_sync();
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_watchdog_leave(NYX_WATCHDOG_RETRY, 0, start);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_bridge_initialize()
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    STR_t env = getenv("NYX_VERBOSE");
+
+    mg_log_set(env != NULL && strcmp(env, "1") == 0 ? MG_LL_DEBUG
+                                                    : MG_LL_INFO
+    );
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* REAL-TIME PROFILE, APPLIED TO THE CALLING (BRIDGE) THREAD BEFORE ANYTHING IS ALLOCATED                         */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(env_bool("NYX_RT", false))
+    {
+        STR_t cpu = getenv("NYX_RT_CPU");
+
+        m_realtime = nyx_realtime_setup(
+            cpu != NULL && cpu[0] != '\0' ? atoi(cpu) : -1,
+            (int) env_size("NYX_RT_PRIORITY", RT_PRIORITY),
+            1024UL * 1024UL * env_size("NYX_RT_HEAP", RT_HEAP)
+        );
+
+        if(m_realtime)
+        {
+            MG_INFO(("Real-time profile enabled"));
+        }
+        else
+        {
+            MG_ERROR(("Real-time profile partially applied"));
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    mg_mgr_init(&m_mgr);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    m_mqtt_opts.version = env_size("NYX_MQTT_VERSION", 4) == 5 ? 0x05 : 0x04;
+    m_mqtt_opts.clean = true;
+
+    nyx_mqtt_set_message_expiry((uint32_t) env_size("NYX_MQTT_EXPIRY", 0));
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    size_t session_expiry = env_size("NYX_MQTT_SESSION", 0);
+
+    if(session_expiry > 0)
+    {
+        m_mqtt_session = nyx_mqtt_session_new(MAX_SESSION_BYTES);
+
+        m_mqtt_session_prop.id = MQTT_PROP_SESSION_EXPIRY_INTERVAL;
+        m_mqtt_session_prop.iv = (uint32_t) session_expiry;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    m_mqtt_bulk_enabled = env_bool("NYX_MQTT_BULK", true);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    m_blob_raw = env_bool("NYX_BLOB_RAW", false);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    m_compress = nyx_compress_parse(getenv("NYX_COMPRESS"));
+
+    if(m_compress < 0)
+    {
+        MG_ERROR(("Unsupported compression algorithm `%s`, compression disabled", getenv("NYX_COMPRESS")));
+
+        m_compress = NYX_COMPRESS_NONE;
+    }
+
+    m_compress_threshold = env_size("NYX_COMPRESS_THRESHOLD", COMPRESS_THRESHOLD);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    m_blob_demand = env_bool("NYX_BLOB_DEMAND", false);
+
+    m_blob_lease_ms = 1000UL * env_size("NYX_BLOB_LEASE", BLOB_LEASE);
+
+    nyx_blob_demand_init(blob_demand_apply);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    m_stats_period = env_size("NYX_STATS_PERIOD", STATS_PERIOD);
+
+    nyx_tracker_init(
+        1000UL * env_size("NYX_COMMAND_SLOW", COMMAND_SLOW),
+        1000000UL * env_size("NYX_COMMAND_TIMEOUT", COMMAND_TIMEOUT)
+    );
+
+    nyx_watchdog_init(1000UL * env_size("NYX_STALL_BUDGET", STALL_BUDGET));
+
+    snprintf(m_compress_topic_out, sizeof(m_compress_topic_out), "%s/%s", MQTT_TOPIC_OUT, nyx_compress_name(m_compress));
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    STR_t capture_file = getenv("NYX_CAPTURE_FILE");
+
+    if(capture_file != NULL && capture_file[0] != '\0')
+    {
+        if(nyx_capture_start(capture_file))
+        {
+            MG_INFO(("Capturing traffic to `%s`", capture_file));
+        }
+        else
+        {
+            MG_ERROR(("Cannot open capture file `%s`", capture_file));
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+#ifdef NYX_TRACE
+    STR_t trace_file = getenv("NYX_TRACE_FILE");
+
+    if(trace_file != NULL && trace_file[0] != '\0')
+    {
+        m_trace_file = trace_file;
+    }
+
+    signal(SIGUSR1, trace_signal_handler);
+#endif
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    m_j2x = nyx_j2x_init(xml_emit);
+
+    nyx_j2x_set_stream_threshold(m_j2x, NYX_J2X_STREAM_THRESHOLD);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    STR_t urls = getenv("NYX_INDI_URLS");
+
+    if(urls == NULL || urls[0] == '\0')
+    {
+        urls = nyx_discover_indi_url();
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    size_t queue_size = env_size("NYX_INDI_QUEUE", INDI_QUEUE);
+
+    uint64_t queue_ttl = 1000000UL * env_size("NYX_INDI_QUEUE_TTL", INDI_QUEUE_TTL);
+
+    struct mg_str item, rest = mg_str(urls);
+
+    while(m_upstream_cnt < MAX_UPSTREAMS && mg_span(rest, &item, &rest, ','))
+    {
+        while(item.len > 0 && item.buf[0] == ' ') {
+            item.buf++;
+            item.len--;
+        }
+
+        while(item.len > 0 && item.buf[item.len - 1] == ' ') {
+            item.len--;
+        }
+
+        if(item.len > 0)
+        {
+            upstream_t *upstream = &m_upstreams[m_upstream_cnt++];
+
+            upstream->url = nyx_string_ndup(item.buf, item.len);
+            upstream->x2j = nyx_x2j_init(json_emit);
+            upstream->queue = queue_size > 0 ? nyx_queue_new(queue_size, MAX_QUEUE_BYTES, queue_ttl) : NULL;
+
+            if(m_blob_raw)
+            {
+                nyx_x2j_set_blob_fn(upstream->x2j, blob_emit);
+            }
+            upstream->refresh = true;
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    m_device_index = nyx_string_map_new();
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    mg_timer_add(&m_mgr, 5000UL, MG_TIMER_REPEAT | MG_TIMER_RUN_NOW, ping_handler, NULL);
+
+    mg_timer_add(&m_mgr, 2000UL, MG_TIMER_REPEAT | MG_TIMER_RUN_NOW, retry_timer_handler, NULL);
+
+    if(m_stats_period > 0)
+    {
+        mg_timer_add(&m_mgr, 1000UL * m_stats_period, MG_TIMER_REPEAT, stats_handler, NULL);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    STR_t spool_file = getenv("NYX_SPOOL_FILE");
+
+    if(spool_file != NULL && spool_file[0] != '\0')
+    {
+        m_spool = nyx_spool_open(spool_file, 1024UL * 1024UL * env_size("NYX_SPOOL_SIZE", SPOOL_SIZE));
+
+        m_spool_budget = 1024UL * env_size("NYX_SPOOL_RATE", SPOOL_RATE) * SPOOL_PERIOD / 1000UL;
+
+        if(m_spool)
+        {
+            mg_timer_add(&m_mgr, SPOOL_PERIOD, MG_TIMER_REPEAT, spool_handler, NULL);
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    m_ws = env_bool("NYX_WS", false);
+
+    nyx_ws_init(1024UL * env_size("NYX_WS_QUEUE", WS_QUEUE));
+
+    STR_t metrics_url = getenv("NYX_METRICS_URL");
+
+    if(metrics_url != NULL && metrics_url[0] != '\0')
+    {
+        if(mg_http_listen(&m_mgr, metrics_url, http_handler, NULL) != NULL)
+        {
+            MG_INFO(("Serving metrics on %s/metrics", metrics_url));
+        }
+        else
+        {
+            MG_ERROR(("Cannot listen on %s", metrics_url));
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* EMBEDDED BROKER, REPLACING THE CONNECTIONS TO AN EXTERNAL ONE                                                  */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    STR_t broker_url = getenv("NYX_MQTT_BROKER");
+
+    if(broker_url != NULL && broker_url[0] != '\0')
+    {
+        if(nyx_broker_start(&m_mgr, broker_url, broker_message))
+        {
+            MG_INFO(("Serving MQTT on %s", broker_url));
+
+            nyx_broker_set_credentials(m_mqtt_user, m_mqtt_pass);
+
+            m_broker = true;
+        }
+        else
+        {
+            MG_ERROR(("Cannot listen on %s", broker_url));
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_bridge_finalize()
+{
+    mg_mgr_free(&m_mgr);
+
+    nyx_broker_stop();
+
+    m_broker = false;
+
+    m_ws = false;
+
+    for(size_t i = 0; i < m_upstream_cnt; i++)
+    {
+        nyx_x2j_close(m_upstreams[i].x2j);
+
+        nyx_queue_free(m_upstreams[i].queue);
+
+        nyx_memory_free(m_upstreams[i].url);
+    }
+
+    m_upstream_cnt = 0;
+
+    nyx_j2x_close(m_j2x);
+
+    nyx_string_map_free(m_device_index);
+
+    nyx_blob_demand_free();
+
+    nyx_tracker_free();
+
+    nyx_capture_stop();
+
+    nyx_spool_close();
+
+    nyx_mqtt_session_free(m_mqtt_session);
+
+    m_mqtt_session = NULL;
+
+    memset(&m_mqtt_session_prop, 0x00, sizeof(m_mqtt_session_prop));
+
+    m_spool = false;
+
+    m_mqtt_ready = false;
+
+    nyx_memory_free(m_mqtt_url);
+    nyx_memory_free(m_mqtt_user);
+    nyx_memory_free(m_mqtt_pass);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_bridge_poll(
+    STR_t mqtt_url,
+    STR_t mqtt_user,
+    STR_t mqtt_pass,
+    int ms
+) {
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(!streq(m_mqtt_url, mqtt_url)
+       ||
        !streq(m_mqtt_user, mqtt_user)
        ||
        !streq(m_mqtt_pass, mqtt_pass)
@@ -328,18 +2277,54 @@ void nyx_bridge_poll(
         m_mqtt_user = nyx_string_dup(nz(mqtt_user));
         m_mqtt_pass = nyx_string_dup(nz(mqtt_pass));
 
+        if(m_broker)
+        {
+            nyx_broker_set_credentials(m_mqtt_user, m_mqtt_pass);
+        }
+
         if(m_mqtt_connection != NULL)
         {
             mg_mqtt_disconnect(m_mqtt_connection, NULL);
 
             m_mqtt_connection->is_closing = 1;
         }
+
+        if(m_mqtt_bulk_connection != NULL)
+        {
+            mg_mqtt_disconnect(m_mqtt_bulk_connection, NULL);
+
+            m_mqtt_bulk_connection->is_closing = 1;
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+#ifdef NYX_TRACE
+    if(m_trace_dump_requested)
+    {
+        m_trace_dump_requested = 0;
+
+        if(nyx_trace_dump_to_file(m_trace_file))
+        {
+            MG_INFO(("Trace written to `%s`", m_trace_file));
+        }
+        else
+        {
+            MG_ERROR(("Cannot write trace to `%s`", m_trace_file));
+        }
     }
+#endif
 
     /*----------------------------------------------------------------------------------------------------------------*/
 
+    NYX_TRACE_BEGIN("poll");
+
     mg_mgr_poll(&m_mgr, ms);
 
+    NYX_TRACE_END("poll");
+
+    nyx_watchdog_iteration();
+
     /*----------------------------------------------------------------------------------------------------------------*/
 }
 
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -43,6 +44,22 @@ buff_t nyx_memory_realloc(
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+typedef struct
+{
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t bytes;
+
+} nyx_memory_stats_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_memory_get_stats(
+    nyx_memory_stats_t *result
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
 str_t nyx_string_dup(
     STR_t s
 );
@@ -105,6 +122,14 @@ void nyx_string_builder_append_buff(
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+str_t nyx_string_builder_reserve(
+    /*-*/ nyx_string_builder_t *sb,
+    uint32_t flags,
+    size_t len
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
 size_t nyx_string_builder_length(
     const nyx_string_builder_t *sb
 );
@@ -143,17 +168,555 @@ str_t nyx_string_builder_to_string(
     _sb;                                                                                                               \
 })
 
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* STRING MAP                                                                                                         */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct nyx_string_map_s nyx_string_map_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef bool (*nyx_string_map_visit_fn)(STR_t key, buff_t value, buff_t arg);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+nyx_string_map_t *nyx_string_map_new(void);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_string_map_free(
+    /*-*/ nyx_string_map_t *map
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_string_map_clear(
+    /*-*/ nyx_string_map_t *map
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+size_t nyx_string_map_size(
+    const nyx_string_map_t *map
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+buff_t nyx_string_map_get(
+    const nyx_string_map_t *map,
+    STR_t key
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+buff_t nyx_string_map_put(
+    /*-*/ nyx_string_map_t *map,
+    STR_t key,
+    buff_t value
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+buff_t nyx_string_map_del(
+    /*-*/ nyx_string_map_t *map,
+    STR_t key
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_string_map_foreach(
+    /*-*/ nyx_string_map_t *map,
+    nyx_string_map_visit_fn visit_fn,
+    buff_t arg
+);
+
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* URL DISCOVERY                                                                                                      */
 /*--------------------------------------------------------------------------------------------------------------------*/
 
 STR_t nyx_discover_indi_url(void);
 
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int nyx_unix_connect(
+    STR_t path
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* BASE64                                                                                                             */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define NYX_BASE64_ENCODED_SIZE(len) (4 * (((len) + 2) / 3))
+
+#define NYX_BASE64_DECODED_SIZE(len) (3 * (((len) + 3) / 4))
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define NYX_BASE64_SCALAR       (0)
+#define NYX_BASE64_SSSE3        (1)
+#define NYX_BASE64_AVX2         (2)
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int nyx_base64_set_level(
+    int level
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+size_t nyx_base64_encode(
+    str_t dst,
+    size_t len,
+    BUFF_t src
+);
+
+size_t nyx_base64_decode(
+    buff_t dst,
+    size_t len,
+    STR_t src
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* COMPRESSION                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define NYX_COMPRESS_NONE       (0)
+#define NYX_COMPRESS_ZLIB       (1)
+#define NYX_COMPRESS_ZSTD       (2)
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int nyx_compress_parse(
+    STR_t name
+);
+
+STR_t nyx_compress_name(
+    int algo
+);
+
+buff_t nyx_compress(
+    int algo,
+    size_t *result_len,
+    size_t len,
+    BUFF_t buff
+);
+
+buff_t nyx_decompress(
+    int algo,
+    size_t *result_len,
+    size_t len,
+    BUFF_t buff
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* BLOB DEMAND                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef void (*nyx_blob_demand_fn)(STR_t device, STR_t name, STR_t policy);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_blob_demand_init(
+    nyx_blob_demand_fn apply_fn
+);
+
+void nyx_blob_demand_free(void);
+
+void nyx_blob_demand_update(
+    STR_t device,
+    STR_t name,
+    STR_t client,
+    STR_t policy,
+    uint64_t expiry
+);
+
+void nyx_blob_demand_expire(
+    uint64_t now
+);
+
+void nyx_blob_demand_replay(void);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* METRICS                                                                                                            */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define NYX_HIST_BUCKETS 280
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define NYX_METRICS_INDI_TO_MQTT 0
+#define NYX_METRICS_MQTT_TO_INDI 1
+#define NYX_METRICS_DIRECTIONS 2
+
+#define NYX_METRICS_DEF 0
+#define NYX_METRICS_SET 1
+#define NYX_METRICS_NEW 2
+#define NYX_METRICS_BLOB 3
+#define NYX_METRICS_OTHER 4
+#define NYX_METRICS_CLASSES 5
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+
+    uint32_t buckets[NYX_HIST_BUCKETS];
+
+} nyx_hist_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    nyx_hist_t hist[NYX_METRICS_DIRECTIONS][NYX_METRICS_CLASSES];
+
+} nyx_metrics_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_hist_record(
+    nyx_hist_t *hist,
+    uint64_t value
+);
+
+uint64_t nyx_hist_quantile(
+    const nyx_hist_t *hist,
+    double q
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+uint64_t nyx_metrics_now(void);
+
+int nyx_metrics_class(
+    STR_t tag
+);
+
+STR_t nyx_metrics_class_name(
+    int cls
+);
+
+void nyx_metrics_record(
+    int direction,
+    int cls,
+    uint64_t start
+);
+
+void nyx_metrics_rotate(void);
+
+void nyx_metrics_snapshot(
+    nyx_metrics_t *result
+);
+
+const nyx_metrics_t *nyx_metrics_cumulative(void);
+
+str_t nyx_metrics_to_json(
+    const nyx_metrics_t *metrics
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* TRACE                                                                                                              */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#ifdef NYX_TRACE
+#  define NYX_TRACE_BEGIN(name) nyx_trace_event((name), 'B')
+#  define NYX_TRACE_END(name) nyx_trace_event((name), 'E')
+#  define NYX_TRACE_INSTANT(name) nyx_trace_event((name), 'i')
+#else
+#  define NYX_TRACE_BEGIN(name) ((void) 0)
+#  define NYX_TRACE_END(name) ((void) 0)
+#  define NYX_TRACE_INSTANT(name) ((void) 0)
+#endif
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_trace_event(
+    STR_t name,
+    char phase
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+str_t nyx_trace_dump(void);
+
+bool nyx_trace_dump_to_file(
+    STR_t path
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* WATCHDOG                                                                                                           */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define NYX_WATCHDOG_INDI 0
+#define NYX_WATCHDOG_MQTT 1
+#define NYX_WATCHDOG_MQTT_BULK 2
+#define NYX_WATCHDOG_HTTP 3
+#define NYX_WATCHDOG_PING 4
+#define NYX_WATCHDOG_STATS 5
+#define NYX_WATCHDOG_RETRY 6
+#define NYX_WATCHDOG_BROKER 7
+#define NYX_WATCHDOG_SPOOL 8
+#define NYX_WATCHDOG_HANDLERS 9
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    nyx_hist_t iteration;
+    nyx_hist_t handler[NYX_WATCHDOG_HANDLERS];
+
+    uint64_t stalls;
+
+    uint64_t last_stall;
+    int last_stall_handler;
+    size_t last_stall_len;
+
+} nyx_watchdog_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_watchdog_init(
+    uint64_t budget
+);
+
+STR_t nyx_watchdog_handler_name(
+    int handler
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+uint64_t nyx_watchdog_enter(void);
+
+void nyx_watchdog_leave(
+    int handler,
+    size_t len,
+    uint64_t start
+);
+
+void nyx_watchdog_iteration(void);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_watchdog_rotate(void);
+
+void nyx_watchdog_snapshot(
+    nyx_watchdog_t *result
+);
+
+const nyx_watchdog_t *nyx_watchdog_cumulative(void);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* REALTIME                                                                                                           */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    uint64_t minor_faults;
+    uint64_t major_faults;
+    uint64_t voluntary_switches;
+    uint64_t involuntary_switches;
+
+} nyx_realtime_stats_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool nyx_realtime_setup(
+    int cpu,
+    int priority,
+    size_t heap_reserve
+);
+
+void nyx_realtime_get_stats(
+    nyx_realtime_stats_t *result
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* CAPTURE                                                                                                            */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define NYX_CAPTURE_INDI 0
+#define NYX_CAPTURE_MQTT 1
+#define NYX_CAPTURE_SESSION 2
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    uint64_t timestamp;
+    int kind;
+    int source;
+    size_t len;
+
+} nyx_capture_header_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef bool (*nyx_capture_visit_fn)(const nyx_capture_header_t *header, BUFF_t buff, buff_t arg);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool nyx_capture_start(
+    STR_t path
+);
+
+void nyx_capture_stop(void);
+
+void nyx_capture_flush(void);
+
+void nyx_capture_record(
+    int kind,
+    int source,
+    size_t len,
+    BUFF_t buff
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool nyx_capture_replay(
+    STR_t path,
+    nyx_capture_visit_fn visit_fn,
+    buff_t arg
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* MESSAGE METADATA                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    STR_t tag;
+    STR_t device;
+    STR_t name;
+    STR_t state;
+
+} nyx_meta_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* COMMAND TRACKER                                                                                                    */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    char device[64];
+    char name[64];
+
+    uint64_t start;
+
+    bool pending;
+    bool acked;
+
+    uint64_t commands;
+    uint64_t timeouts;
+    uint64_t stalls;
+    uint64_t alerts;
+
+    nyx_hist_t ack;
+    nyx_hist_t done;
+
+} nyx_tracker_entry_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef void (*nyx_tracker_visit_fn)(const nyx_tracker_entry_t *entry, buff_t arg);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_tracker_init(
+    uint64_t slow_us,
+    uint64_t timeout_us
+);
+
+void nyx_tracker_free(void);
+
+void nyx_tracker_command(
+    const nyx_meta_t *meta,
+    uint64_t start
+);
+
+void nyx_tracker_update(
+    const nyx_meta_t *meta,
+    uint64_t now
+);
+
+void nyx_tracker_expire(
+    uint64_t now
+);
+
+void nyx_tracker_foreach(
+    nyx_tracker_visit_fn visit_fn,
+    buff_t arg
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* COMMAND QUEUE                                                                                                      */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    size_t size;
+    size_t bytes;
+
+    uint64_t queued;
+    uint64_t conflated;
+    uint64_t expired;
+
+} nyx_queue_stats_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+struct mg_connection;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct nyx_queue_s nyx_queue_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+nyx_queue_t *nyx_queue_new(
+    size_t max_commands,
+    size_t max_bytes,
+    uint64_t ttl_us
+);
+
+void nyx_queue_free(
+    nyx_queue_t *queue
+);
+
+void nyx_queue_push(
+    nyx_queue_t *queue,
+    uint64_t seq,
+    const nyx_meta_t *meta,
+    size_t len,
+    STR_t xml,
+    uint64_t now
+);
+
+void nyx_queue_expire(
+    nyx_queue_t *queue,
+    uint64_t now
+);
+
+size_t nyx_queue_flush(
+    nyx_queue_t *queue,
+    struct mg_connection *connection,
+    uint64_t now
+);
+
+void nyx_queue_get_stats(
+    const nyx_queue_t *queue,
+    nyx_queue_stats_t *result
+);
+
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* XML -> JSON                                                                                                        */
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-typedef void (*nyx_x2j_emit_fn)(size_t len, STR_t json);
+typedef void (*nyx_x2j_emit_fn)(size_t len, STR_t json, const nyx_meta_t *meta);
+
+typedef STR_t (*nyx_x2j_blob_fn)(const nyx_meta_t *meta, STR_t element, size_t len, BUFF_t buff);
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
@@ -175,11 +738,29 @@ void nyx_x2j_feed(
     STR_t text
 );
 
+bool nyx_x2j_push_fd(
+    nyx_x2j_ctx_t *ctx,
+    int fd
+);
+
+void nyx_x2j_reset_fds(
+    nyx_x2j_ctx_t *ctx
+);
+
+void nyx_x2j_set_blob_fn(
+    nyx_x2j_ctx_t *ctx,
+    nyx_x2j_blob_fn blob_fn
+);
+
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* JSON -> XML                                                                                                        */
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-typedef void (*nyx_j2x_emit_fn)(size_t len, STR_t xml);
+#define NYX_J2X_STREAM_THRESHOLD 65536UL
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef void (*nyx_j2x_emit_fn)(size_t len, STR_t xml, const nyx_meta_t *meta);
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
@@ -188,7 +769,7 @@ typedef struct nyx_j2x_ctx_s nyx_j2x_ctx_t;
 /*--------------------------------------------------------------------------------------------------------------------*/
 
 nyx_j2x_ctx_t *nyx_j2x_init(
-    nyx_x2j_emit_fn emit_fn
+    nyx_j2x_emit_fn emit_fn
 );
 
 void nyx_j2x_close(
@@ -201,6 +782,241 @@ void nyx_j2x_feed(
     STR_t text
 );
 
+void nyx_j2x_set_stream_threshold(
+    nyx_j2x_ctx_t *ctx,
+    size_t stream_threshold
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* MQTT                                                                                                               */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+struct mg_connection;
+
+struct mg_mqtt_message;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_mqtt_set_message_expiry(
+    uint32_t seconds
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool nyx_mqtt_open(
+    struct mg_connection *connection,
+    const struct mg_mqtt_message *connack
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+uint16_t nyx_mqtt_pub(
+    struct mg_connection *connection,
+    STR_t topic,
+    uint16_t alias,
+    const nyx_meta_t *meta,
+    size_t len,
+    BUFF_t buff,
+    uint8_t qos
+);
+
+void nyx_mqtt_ack(
+    struct mg_connection *connection,
+    const struct mg_mqtt_message *message
+);
+
+uint32_t nyx_mqtt_inflight(
+    const struct mg_connection *connection
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* PERSISTENT MQTT SESSION                                                                                            */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    uint64_t inflight;
+
+    uint64_t retransmitted;
+    uint64_t untracked;
+    uint64_t duplicates;
+
+} nyx_mqtt_session_stats_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct nyx_mqtt_session_s nyx_mqtt_session_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+nyx_mqtt_session_t *nyx_mqtt_session_new(
+    size_t max_bytes
+);
+
+void nyx_mqtt_session_free(
+    nyx_mqtt_session_t *session
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_mqtt_session_pub(
+    nyx_mqtt_session_t *session,
+    struct mg_connection *connection,
+    STR_t topic,
+    uint16_t alias,
+    const nyx_meta_t *meta,
+    size_t len,
+    BUFF_t buff,
+    uint8_t qos
+);
+
+void nyx_mqtt_session_ack(
+    nyx_mqtt_session_t *session,
+    const struct mg_mqtt_message *message
+);
+
+bool nyx_mqtt_session_accept(
+    nyx_mqtt_session_t *session,
+    const struct mg_mqtt_message *message
+);
+
+void nyx_mqtt_session_resume(
+    nyx_mqtt_session_t *session,
+    struct mg_connection *connection,
+    bool present
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_mqtt_session_get_stats(
+    const nyx_mqtt_session_t *session,
+    nyx_mqtt_session_stats_t *result
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* EMBEDDED BROKER                                                                                                    */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+struct mg_mgr;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef void (*nyx_broker_msg_fn)(size_t topic_len, STR_t topic, size_t len, BUFF_t buff);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool nyx_broker_start(
+    struct mg_mgr *mgr,
+    STR_t url,
+    nyx_broker_msg_fn msg_fn
+);
+
+void nyx_broker_stop(void);
+
+void nyx_broker_set_credentials(
+    STR_t user,
+    STR_t pass
+);
+
+void nyx_broker_publish(
+    STR_t topic,
+    const nyx_meta_t *meta,
+    size_t len,
+    BUFF_t buff
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+size_t nyx_broker_clients(void);
+
+uint64_t nyx_broker_dropped(void);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* WEBSOCKET                                                                                                          */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_ws_init(
+    size_t queue_limit
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_ws_open(
+    struct mg_connection *connection,
+    size_t query_len,
+    STR_t query
+);
+
+void nyx_ws_close(
+    struct mg_connection *connection
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_ws_publish(
+    const nyx_meta_t *meta,
+    size_t len,
+    STR_t json
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+size_t nyx_ws_clients(void);
+
+uint64_t nyx_ws_dropped(void);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* SPOOL                                                                                                              */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    uint64_t messages;
+    uint64_t bytes;
+
+    uint64_t spooled;
+    uint64_t replayed;
+    uint64_t evicted;
+    uint64_t rejected;
+
+} nyx_spool_stats_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef void (*nyx_spool_visit_fn)(const nyx_meta_t *meta, size_t len, STR_t json);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool nyx_spool_open(
+    STR_t path,
+    size_t capacity
+);
+
+void nyx_spool_close(void);
+
+void nyx_spool_sync(void);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool nyx_spool_empty(void);
+
+void nyx_spool_append(
+    const nyx_meta_t *meta,
+    size_t len,
+    STR_t json
+);
+
+size_t nyx_spool_replay(
+    size_t budget,
+    nyx_spool_visit_fn visit_fn
+);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_spool_get_stats(
+    nyx_spool_stats_t *result
+);
+
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* BRIDGE                                                                                                             */
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,559 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "external/mongoose.h"
+
+#include "bridge.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define MAX_FILTERS 16
+
+#define MAX_SEND_QUEUE (16UL * 1024UL * 1024UL)
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct client_s
+{
+    struct mg_connection *connection;
+
+    bool connected;
+
+    size_t filter_cnt;
+
+    str_t filters[MAX_FILTERS];
+
+    struct client_s *next;
+
+} client_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static client_t *m_clients = NULL;
+
+static size_t m_client_cnt = 0;
+
+static uint64_t m_dropped = 0;
+
+static nyx_broker_msg_fn m_msg_fn = NULL;
+
+static str_t m_user = NULL;
+static str_t m_pass = NULL;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* MQTT TOPIC FILTERS: '+' MATCHES ONE LEVEL, A TRAILING '#' ANY NUMBER OF LEVELS (INCLUDING THE PARENT ONE)          */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool topic_match(STR_t filter, size_t topic_len, STR_t topic)
+{
+    if(topic_len > 0 && topic[0] == '$' && (filter[0] == '+' || filter[0] == '#'))
+    {
+        return false;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    size_t j = 0;
+
+    for(; *filter != '\0'; filter++)
+    {
+        /**/ if(*filter == '#') {
+            return true;
+        }
+        else if(*filter == '+') {
+            while(j < topic_len && topic[j] != '/') j++;
+        }
+        else if(j < topic_len && *filter == topic[j]) {
+            j++;
+        }
+        else if(j == topic_len && strcmp(filter, "/#") == 0) {
+            return true;
+        }
+        else {
+            return false;
+        }
+    }
+
+    return j == topic_len;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool client_match(const client_t *client, size_t topic_len, STR_t topic)
+{
+    for(size_t i = 0; i < client->filter_cnt; i++)
+    {
+        if(topic_match(client->filters[i], topic_len, topic))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void client_free(client_t *client)
+{
+    for(client_t **pp = &m_clients; *pp != NULL; pp = &(*pp)->next)
+    {
+        if(*pp == client)
+        {
+            *pp = client->next;
+
+            m_client_cnt--;
+
+            break;
+        }
+    }
+
+    for(size_t i = 0; i < client->filter_cnt; i++)
+    {
+        nyx_memory_free(client->filters[i]);
+    }
+
+    nyx_memory_free(client);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* PACKETS                                                                                                            */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static STR_t skip_header(const struct mg_mqtt_message *message)
+{
+    STR_t p = message->dgram.buf + 1;
+
+    while((*p++ & 0x80) != 0);
+
+    return p;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static STR_t skip_props(const struct mg_connection *connection, STR_t p, STR_t end)
+{
+    if(connection->is_mqtt5 && p < end)
+    {
+        size_t size = 0;
+
+        for(size_t i = 0, shift = 0; i < 4 && p < end; i++, shift += 7)
+        {
+            uint8_t byte = (uint8_t) *p++;
+
+            size |= (size_t) (byte & 0x7F) << shift;
+
+            if((byte & 0x80) == 0)
+            {
+                break;
+            }
+        }
+
+        p += size;
+    }
+
+    return p;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool read_field(STR_t *p, STR_t end, size_t *field_len, STR_t *field)
+{
+    if(*p + 2 > end)
+    {
+        return false;
+    }
+
+    *field_len = ((size_t) (uint8_t) (*p)[0] << 8) | (size_t) (uint8_t) (*p)[1];
+
+    *field = *p + 2;
+
+    *p += 2 + *field_len;
+
+    return *p <= end;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool field_eq(size_t field_len, STR_t field, STR_t expected)
+{
+    expected = expected != NULL ? expected : "";
+
+    return strlen(expected) == field_len && memcmp(expected, field, field_len) == 0;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool broker_connect(struct mg_connection *connection, const struct mg_mqtt_message *message)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* VARIABLE HEADER = PROTOCOL NAME ("MQTT"), PROTOCOL LEVEL (4 OR 5), FLAGS, KEEP ALIVE, [PROPERTIES]             */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    STR_t p = skip_header(message);
+
+    STR_t end = message->dgram.buf + message->dgram.len;
+
+    connection->is_mqtt5 = (p + 6 < end && p[6] == 5);
+
+    uint8_t flags = p + 7 < end ? (uint8_t) p[7] : 0x00;
+
+    p = skip_props(connection, p + 10, end);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* PAYLOAD = CLIENT ID, [WILL PROPERTIES, WILL TOPIC, WILL MESSAGE], [USER NAME], [PASSWORD]                      */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    size_t user_len = 0, pass_len = 0, field_len;
+
+    STR_t user = "";
+    STR_t pass = "";
+    STR_t field;
+
+    bool valid = read_field(&p, end, &field_len, &field);
+
+    if(valid && (flags & 0x04) != 0)
+    {
+        p = skip_props(connection, p, end);
+
+        valid = read_field(&p, end, &field_len, &field)
+                &&
+                read_field(&p, end, &field_len, &field)
+        ;
+    }
+
+    if(valid && (flags & 0x80) != 0)
+    {
+        valid = read_field(&p, end, &user_len, &user);
+    }
+
+    if(valid && (flags & 0x40) != 0)
+    {
+        valid = read_field(&p, end, &pass_len, &pass);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* THE DRIVER'S MQTT USER NAME AND PASSWORD ARE REQUIRED, AS WITH AN EXTERNAL BROKER                              */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    bool result = valid && field_eq(user_len, user, m_user) && field_eq(pass_len, pass, m_pass);
+
+    if(result == false)
+    {
+        MG_ERROR(("%lu BROKER CONNECT refused", connection->id));
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(connection->is_mqtt5)
+    {
+        mg_mqtt_send_header(connection, MQTT_CMD_CONNACK, 0, 3);
+
+        mg_send(connection, result ? "\x00\x00\x00" : "\x00\x87\x00", 3);
+    }
+    else
+    {
+        mg_mqtt_send_header(connection, MQTT_CMD_CONNACK, 0, 2);
+
+        mg_send(connection, result ? "\x00\x00" : "\x00\x05", 2);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return result;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void broker_subscribe(struct mg_connection *connection, client_t *client, const struct mg_mqtt_message *message)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    bool subscribe = message->cmd == MQTT_CMD_SUBSCRIBE;
+
+    STR_t end = message->dgram.buf + message->dgram.len;
+
+    STR_t p = skip_props(connection, skip_header(message) + 2, end);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint8_t codes[32];
+
+    size_t code_cnt = 0;
+
+    while(p + 2 <= end && code_cnt < sizeof(codes))
+    {
+        size_t topic_len = ((size_t) (uint8_t) p[0] << 8) | (size_t) (uint8_t) p[1];
+
+        STR_t topic = p + 2;
+
+        p += 2 + topic_len + (subscribe ? 1 : 0);
+
+        if(p > end)
+        {
+            break;
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        size_t i;
+
+        for(i = 0; i < client->filter_cnt; i++)
+        {
+            if(strlen(client->filters[i]) == topic_len && memcmp(client->filters[i], topic, topic_len) == 0)
+            {
+                break;
+            }
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        /**/ if(subscribe && i == client->filter_cnt && client->filter_cnt < MAX_FILTERS)
+        {
+            client->filters[client->filter_cnt++] = nyx_string_ndup(topic, topic_len);
+
+            codes[code_cnt++] = 0x00; /* GRANTED QOS 0 */
+        }
+        else if(subscribe && i < client->filter_cnt)
+        {
+            codes[code_cnt++] = 0x00; /* ALREADY SUBSCRIBED */
+        }
+        else if(subscribe)
+        {
+            codes[code_cnt++] = 0x80; /* FAILURE */
+        }
+        else if(i < client->filter_cnt)
+        {
+            nyx_memory_free(client->filters[i]);
+
+            client->filters[i] = client->filters[--client->filter_cnt];
+
+            codes[code_cnt++] = 0x00; /* SUCCESS */
+        }
+        else
+        {
+            codes[code_cnt++] = 0x11; /* NO SUBSCRIPTION EXISTED */
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* SUBACK / UNSUBACK = PACKET IDENTIFIER, [PROPERTIES], REASON CODES (NONE FOR AN MQTT 3.1.1 UNSUBACK)            */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint16_t id = mg_ntohs(message->id);
+
+    if(subscribe == false && connection->is_mqtt5 == 0)
+    {
+        code_cnt = 0;
+    }
+
+    mg_mqtt_send_header(connection, subscribe ? MQTT_CMD_SUBACK : MQTT_CMD_UNSUBACK, 0, (uint32_t) (sizeof(id) + connection->is_mqtt5 + code_cnt));
+
+    mg_send(connection, &id, sizeof(id));
+
+    if(connection->is_mqtt5)
+    {
+        mg_send(connection, "\x00", 1);
+    }
+
+    mg_send(connection, codes, code_cnt);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void broker_handler(struct mg_connection *connection, int ev, void *ev_data)
+{
+    uint64_t start = nyx_watchdog_enter();
+
+    client_t *client = connection->fn_data;
+
+    size_t len = 0;
+
+    /**/ if(ev == MG_EV_ACCEPT)
+    {
+        client = nyx_memory_alloc(sizeof(client_t));
+
+        memset(client, 0x00, sizeof(client_t));
+
+        client->connection = connection;
+
+        client->next = m_clients;
+
+        m_clients = client;
+
+        m_client_cnt++;
+
+        connection->fn_data = client;
+
+        MG_INFO(("%lu BROKER ACCEPT", connection->id));
+    }
+    else if(ev == MG_EV_CLOSE)
+    {
+        if(client != NULL && connection->is_listening == 0)
+        {
+            MG_INFO(("%lu BROKER CLOSE", connection->id));
+
+            client_free(client);
+        }
+    }
+    else if(ev == MG_EV_ERROR)
+    {
+        MG_ERROR(("%lu BROKER ERROR %s", connection->id, (STR_t) ev_data));
+    }
+    else if(ev == MG_EV_MQTT_CMD)
+    {
+        const struct mg_mqtt_message *message = ev_data;
+
+        /**/ if(message->cmd == MQTT_CMD_CONNECT && client->connected == false)
+        {
+            client->connected = broker_connect(connection, message);
+
+            if(client->connected == false)
+            {
+                connection->is_draining = 1;
+            }
+        }
+        else if(client->connected == false)
+        {
+            connection->is_draining = 1;
+        }
+        else if(message->cmd == MQTT_CMD_SUBSCRIBE || message->cmd == MQTT_CMD_UNSUBSCRIBE)
+        {
+            broker_subscribe(connection, client, message);
+        }
+        else if(message->cmd == MQTT_CMD_PINGREQ)
+        {
+            mg_mqtt_pong(connection);
+        }
+        else if(message->cmd == MQTT_CMD_DISCONNECT)
+        {
+            connection->is_draining = 1;
+        }
+    }
+    else if(ev == MG_EV_MQTT_MSG && client->connected)
+    {
+        const struct mg_mqtt_message *message = ev_data;
+
+        len = message->data.len;
+
+        /*------------------------------------------------------------------------------------------------------------*/
+        /* CLIENT PUBLISHES ARE FANNED OUT LIKE THE BRIDGE'S OWN, THEN HANDED TO THE BRIDGE                           */
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        char topic[256];
+
+        if(message->topic.len < sizeof(topic))
+        {
+            memcpy(topic, message->topic.buf, message->topic.len);
+
+            topic[message->topic.len] = '\0';
+
+            nyx_broker_publish(topic, NULL, message->data.len, message->data.buf);
+        }
+
+        if(m_msg_fn != NULL)
+        {
+            m_msg_fn(message->topic.len, message->topic.buf, message->data.len, message->data.buf);
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+    }
+
+    nyx_watchdog_leave(NYX_WATCHDOG_BROKER, len, start);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* BROKER                                                                                                             */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool nyx_broker_start(struct mg_mgr *mgr, STR_t url, nyx_broker_msg_fn msg_fn)
+{
+    m_msg_fn = msg_fn;
+
+    return mg_mqtt_listen(mgr, url, broker_handler, NULL) != NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_broker_stop(void)
+{
+    while(m_clients != NULL)
+    {
+        client_free(m_clients);
+    }
+
+    nyx_memory_free(m_user);
+    nyx_memory_free(m_pass);
+
+    m_user = NULL;
+    m_pass = NULL;
+
+    m_msg_fn = NULL;
+
+    m_dropped = 0;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_broker_set_credentials(STR_t user, STR_t pass)
+{
+    nyx_memory_free(m_user);
+    nyx_memory_free(m_pass);
+
+    m_user = nyx_string_dup(user != NULL ? user : "");
+    m_pass = nyx_string_dup(pass != NULL ? pass : "");
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_broker_publish(STR_t topic, const nyx_meta_t *meta, size_t len, BUFF_t buff)
+{
+    size_t topic_len = strlen(topic);
+
+    for(client_t *client = m_clients; client != NULL; client = client->next)
+    {
+        if(client->connected && client_match(client, topic_len, topic))
+        {
+            /*--------------------------------------------------------------------------------------------------------*/
+            /* A SLOW SUBSCRIBER MUST NOT MAKE THE BRIDGE BUFFER WITHOUT BOUND, AN IDLE ONE GETS MESSAGES OF ANY SIZE */
+            /*--------------------------------------------------------------------------------------------------------*/
+
+            if(client->connection->send.len > 0 && client->connection->send.len + len > MAX_SEND_QUEUE)
+            {
+                m_dropped++;
+
+                continue;
+            }
+
+            /*--------------------------------------------------------------------------------------------------------*/
+
+            nyx_mqtt_pub(client->connection, topic, 0, meta, len, buff, 0);
+
+            /*--------------------------------------------------------------------------------------------------------*/
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+size_t nyx_broker_clients(void)
+{
+    return m_client_cnt;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+uint64_t nyx_broker_dropped(void)
+{
+    return m_dropped;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
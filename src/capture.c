@@ -0,0 +1,228 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bridge.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* FILE = MAGIC, THEN RECORDS = 16-BYTE HEADER (TIMESTAMP, KIND, SOURCE, LENGTH) + PAYLOAD, ALL LITTLE-ENDIAN         */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define MAGIC "NYXCAP\x01\n"
+
+#define MAGIC_SIZE 8
+
+#define HEADER_SIZE 16
+
+#define WRITE_BUFF_SIZE (1024 * 1024)
+
+#define MAX_RECORD_SIZE (256UL * 1024UL * 1024UL)
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static FILE *m_file = NULL;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void put_le(uint8_t *dst, uint64_t value, size_t size)
+{
+    for(size_t i = 0; i < size; i++)
+    {
+        dst[i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static uint64_t get_le(const uint8_t *src, size_t size)
+{
+    uint64_t result = 0;
+
+    for(size_t i = 0; i < size; i++)
+    {
+        result |= (uint64_t) src[i] << (8 * i);
+    }
+
+    return result;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* WRITER                                                                                                             */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void write_record(int kind, int source, size_t len, BUFF_t buff)
+{
+    uint8_t header[HEADER_SIZE] = {0};
+
+    put_le(header + 0, nyx_metrics_now(), 8);
+    put_le(header + 8, (uint64_t) kind, 1);
+    put_le(header + 9, (uint64_t) source, 1);
+    put_le(header + 12, (uint64_t) len, 4);
+
+    fwrite(header, 1, HEADER_SIZE, m_file);
+
+    if(len > 0)
+    {
+        fwrite(buff, 1, len, m_file);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool nyx_capture_start(STR_t path)
+{
+    nyx_capture_stop();
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    m_file = fopen(path, "ab");
+
+    if(m_file == NULL)
+    {
+        return false;
+    }
+
+    setvbuf(m_file, NULL, _IOFBF, WRITE_BUFF_SIZE);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* APPENDING TO AN EXISTING CAPTURE KEEPS A SINGLE MAGIC                                                          */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    fseek(m_file, 0, SEEK_END);
+
+    if(ftell(m_file) == 0)
+    {
+        fwrite(MAGIC, 1, MAGIC_SIZE, m_file);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* TIMESTAMPS ARE MONOTONIC, THEIR ORIGIN CHANGES ACROSS RESTARTS: EACH RUN STARTS WITH A SESSION RECORD          */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    write_record(NYX_CAPTURE_SESSION, 0, 0, NULL);
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_capture_stop(void)
+{
+    if(m_file != NULL)
+    {
+        fclose(m_file);
+
+        m_file = NULL;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_capture_flush(void)
+{
+    if(m_file != NULL)
+    {
+        fflush(m_file);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_capture_record(int kind, int source, size_t len, BUFF_t buff)
+{
+    if(m_file != NULL && len > 0)
+    {
+        write_record(kind, source, len, buff);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* READER                                                                                                             */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool nyx_capture_replay(STR_t path, nyx_capture_visit_fn visit_fn, buff_t arg)
+{
+    FILE *fp = fopen(path, "rb");
+
+    if(fp == NULL)
+    {
+        return false;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    char magic[MAGIC_SIZE];
+
+    if(fread(magic, 1, MAGIC_SIZE, fp) != MAGIC_SIZE || memcmp(magic, MAGIC, MAGIC_SIZE) != 0)
+    {
+        fclose(fp);
+
+        return false;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    bool result = true;
+
+    size_t size = 0;
+
+    buff_t buff = NULL;
+
+    uint8_t header[HEADER_SIZE];
+
+    while(fread(header, 1, HEADER_SIZE, fp) == HEADER_SIZE)
+    {
+        nyx_capture_header_t record = {
+            .timestamp = get_le(header + 0, 8),
+            .kind = (int) get_le(header + 8, 1),
+            .source = (int) get_le(header + 9, 1),
+            .len = (size_t) get_le(header + 12, 4),
+        };
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        if(record.len > MAX_RECORD_SIZE)
+        {
+            result = false;
+
+            break;
+        }
+
+        if(size < record.len + 1)
+        {
+            buff = nyx_memory_realloc(buff, size = record.len + 1);
+        }
+
+        if(fread(buff, 1, record.len, fp) != record.len)
+        {
+            result = false; /* TRUNCATED LAST RECORD */
+
+            break;
+        }
+
+        ((str_t) buff)[record.len] = '\0';
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        if(visit_fn(&record, buff, arg) == false)
+        {
+            break;
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_memory_free(buff);
+
+    fclose(fp);
+
+    return result;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
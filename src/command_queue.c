@@ -0,0 +1,335 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "external/mongoose.h"
+
+#include "bridge.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct entry_s
+{
+    str_t key;
+
+    uint64_t seq;
+
+    uint64_t time;
+
+    size_t len;
+
+    buff_t data;
+
+    struct entry_s *next;
+
+} entry_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+struct nyx_queue_s
+{
+    entry_t *head;
+    entry_t *tail;
+
+    size_t max_commands;
+    size_t max_bytes;
+
+    uint64_t ttl_us;
+
+    bool discarding;
+
+    uint64_t discard_seq;
+
+    nyx_queue_stats_t stats;
+};
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void entry_free(entry_t *entry)
+{
+    nyx_memory_free(entry->data);
+
+    nyx_memory_free(entry->key);
+
+    nyx_memory_free(entry);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void unlink_entry(nyx_queue_t *queue, entry_t *prev, entry_t *entry)
+{
+    if(prev != NULL)
+    {
+        prev->next = entry->next;
+    }
+    else
+    {
+        queue->head = entry->next;
+    }
+
+    if(queue->tail == entry)
+    {
+        queue->tail = prev;
+    }
+
+    queue->stats.size--;
+    queue->stats.bytes -= entry->len;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void drop_entry(nyx_queue_t *queue, entry_t *prev, entry_t *entry)
+{
+    MG_DEBUG(("Queued command `%s` expired", entry->key));
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* THE REMAINING FRAGMENTS OF A STREAMED COMMAND MUST NOT BE SENT WITHOUT ITS BEGINNING                           */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(entry == queue->tail)
+    {
+        queue->discarding = true;
+
+        queue->discard_seq = entry->seq;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    unlink_entry(queue, prev, entry);
+
+    queue->stats.expired++;
+
+    entry_free(entry);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void enforce_limits(nyx_queue_t *queue)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* A COMMAND LARGER THAN THE WHOLE QUEUE DOES NOT EVICT THE OTHERS                                                */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(queue->tail != NULL && queue->tail->len > queue->max_bytes)
+    {
+        entry_t *prev = NULL;
+
+        for(entry_t *entry = queue->head; entry != queue->tail; entry = entry->next)
+        {
+            prev = entry;
+        }
+
+        drop_entry(queue, prev, queue->tail);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* OLDEST FIRST                                                                                                   */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    while(queue->head != NULL && (queue->stats.size > queue->max_commands || queue->stats.bytes > queue->max_bytes))
+    {
+        drop_entry(queue, NULL, queue->head);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+nyx_queue_t *nyx_queue_new(size_t max_commands, size_t max_bytes, uint64_t ttl_us)
+{
+    nyx_queue_t *result = nyx_memory_alloc(sizeof(nyx_queue_t));
+
+    memset(result, 0x00, sizeof(nyx_queue_t));
+
+    result->max_commands = max_commands;
+    result->max_bytes = max_bytes;
+    result->ttl_us = ttl_us;
+
+    return result;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_queue_free(nyx_queue_t *queue)
+{
+    if(queue != NULL)
+    {
+        for(entry_t *entry = queue->head, *next; entry != NULL; entry = next)
+        {
+            next = entry->next;
+
+            entry_free(entry);
+        }
+
+        nyx_memory_free(queue);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* seq IDENTIFIES THE COMMAND: THE FRAGMENTS OF A STREAMED COMMAND SHARE IT AND ARE APPENDED TO THE SAME ENTRY        */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_queue_push(nyx_queue_t *queue, uint64_t seq, const nyx_meta_t *meta, size_t len, STR_t xml, uint64_t now)
+{
+    if(len == 0 || xml == NULL || (queue->discarding && queue->discard_seq == seq))
+    {
+        return;
+    }
+
+    queue->discarding = false;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* NEXT FRAGMENT                                                                                                  */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    entry_t *entry = queue->tail;
+
+    if(entry != NULL && entry->seq == seq)
+    {
+        entry->data = nyx_memory_realloc(entry->data, entry->len + len);
+
+        memcpy((str_t) entry->data + entry->len, xml, len);
+
+        entry->len += len;
+
+        queue->stats.bytes += len;
+
+        enforce_limits(queue);
+
+        return;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* NEW COMMAND, REPLACING ANY OLDER ONE FOR THE SAME PROPERTY                                                     */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    char key[256];
+
+    snprintf(key, sizeof(key), "%s\n%s\n%s",
+        meta->tag != NULL ? meta->tag : "",
+        meta->device != NULL ? meta->device : "",
+        meta->name != NULL ? meta->name : ""
+    );
+
+    for(entry_t *prev = NULL, *curr = queue->head; curr != NULL; prev = curr, curr = curr->next)
+    {
+        if(strcmp(curr->key, key) == 0)
+        {
+            unlink_entry(queue, prev, curr);
+
+            entry_free(curr);
+
+            queue->stats.conflated++;
+
+            break;
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    entry = nyx_memory_alloc(sizeof(entry_t));
+
+    entry->key = nyx_string_dup(key);
+    entry->seq = seq;
+    entry->time = now;
+    entry->len = len;
+    entry->data = nyx_memory_alloc(len);
+    entry->next = NULL;
+
+    memcpy(entry->data, xml, len);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(queue->tail != NULL)
+    {
+        queue->tail->next = entry;
+    }
+    else
+    {
+        queue->head = entry;
+    }
+
+    queue->tail = entry;
+
+    queue->stats.size++;
+    queue->stats.bytes += len;
+
+    queue->stats.queued++;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    enforce_limits(queue);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_queue_expire(nyx_queue_t *queue, uint64_t now)
+{
+    while(queue->head != NULL && now > queue->head->time + queue->ttl_us)
+    {
+        drop_entry(queue, NULL, queue->head);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+size_t nyx_queue_flush(nyx_queue_t *queue, struct mg_connection *connection, uint64_t now)
+{
+    nyx_queue_expire(queue, now);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    size_t result = queue->stats.bytes;
+
+    if(result == 0)
+    {
+        return 0;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* ONE ALLOCATION, ONE WRITE                                                                                      */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    mg_iobuf_resize(&connection->send, connection->send.len + result);
+
+    for(entry_t *entry = queue->head, *next; entry != NULL; entry = next)
+    {
+        next = entry->next;
+
+        mg_send(connection, entry->data, entry->len);
+
+        entry_free(entry);
+    }
+
+    MG_INFO(("%lu INDI SEND %lu queued commands (%lu bytes)", connection->id, (unsigned long) queue->stats.size, (unsigned long) result));
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    queue->head = NULL;
+    queue->tail = NULL;
+
+    queue->stats.size = 0;
+    queue->stats.bytes = 0;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return result;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_queue_get_stats(const nyx_queue_t *queue, nyx_queue_stats_t *result)
+{
+    memcpy(result, &queue->stats, sizeof(nyx_queue_stats_t));
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,253 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "external/mongoose.h"
+
+#include "bridge.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* (DEVICE, PROPERTY) -> ENTRY                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static nyx_string_map_t *m_entries = NULL;
+
+static uint64_t m_slow_us = 0;
+
+static uint64_t m_timeout_us = 0;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    nyx_tracker_visit_fn visit_fn;
+
+    buff_t arg;
+
+    uint64_t now;
+
+} visit_ctx_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool is_valid(const nyx_meta_t *meta)
+{
+    return meta->device != NULL && meta->device[0] != '\0'
+           &&
+           meta->name != NULL && meta->name[0] != '\0'
+    ;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void key_of(str_t dst, size_t size, const nyx_meta_t *meta)
+{
+    snprintf(dst, size, "%s\n%s", meta->device, meta->name);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool free_entry(__attribute__ ((unused)) STR_t key, buff_t entry, __attribute__ ((unused)) buff_t arg)
+{
+    nyx_memory_free(entry);
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool expire_entry(__attribute__ ((unused)) STR_t key, buff_t entry, buff_t arg)
+{
+    nyx_tracker_entry_t *e = entry;
+
+    uint64_t now = ((const visit_ctx_t *) arg)->now;
+
+    if(e->pending && now > e->start + m_timeout_us)
+    {
+        /**/ if(e->acked == false)
+        {
+            MG_ERROR(("`%s.%s` did not answer within %lu ms", e->device, e->name, (unsigned long) (m_timeout_us / 1000)));
+
+            e->timeouts++;
+        }
+        else
+        {
+            MG_ERROR(("`%s.%s` did not complete within %lu ms", e->device, e->name, (unsigned long) (m_timeout_us / 1000)));
+
+            e->stalls++;
+        }
+
+        e->pending = false;
+    }
+
+    return false;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool visit_entry(__attribute__ ((unused)) STR_t key, buff_t entry, buff_t arg)
+{
+    const visit_ctx_t *ctx = arg;
+
+    ctx->visit_fn(entry, ctx->arg);
+
+    return false;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_tracker_init(uint64_t slow_us, uint64_t timeout_us)
+{
+    m_entries = nyx_string_map_new();
+
+    m_slow_us = slow_us;
+
+    m_timeout_us = timeout_us;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_tracker_free(void)
+{
+    if(m_entries != NULL)
+    {
+        nyx_string_map_foreach(m_entries, free_entry, NULL);
+
+        nyx_string_map_free(m_entries);
+
+        m_entries = NULL;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_tracker_command(const nyx_meta_t *meta, uint64_t start)
+{
+    if(is_valid(meta) == false)
+    {
+        return;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    char key[256];
+
+    key_of(key, sizeof(key), meta);
+
+    nyx_tracker_entry_t *entry = nyx_string_map_get(m_entries, key);
+
+    if(entry == NULL)
+    {
+        entry = nyx_memory_alloc(sizeof(nyx_tracker_entry_t));
+
+        memset(entry, 0x00, sizeof(nyx_tracker_entry_t));
+
+        snprintf(entry->device, sizeof(entry->device), "%s", meta->device);
+        snprintf(entry->name, sizeof(entry->name), "%s", meta->name);
+
+        nyx_string_map_put(m_entries, key, entry);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    entry->start = start;
+
+    entry->pending = true;
+
+    entry->acked = false;
+
+    entry->commands++;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_tracker_update(const nyx_meta_t *meta, uint64_t now)
+{
+    if(is_valid(meta) == false)
+    {
+        return;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    char key[256];
+
+    key_of(key, sizeof(key), meta);
+
+    nyx_tracker_entry_t *entry = nyx_string_map_get(m_entries, key);
+
+    if(entry == NULL || entry->pending == false)
+    {
+        return;
+    }
+
+    uint64_t elapsed = now > entry->start ? now - entry->start : 0;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* FIRST UPDATE = ACKNOWLEDGEMENT                                                                                 */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(entry->acked == false)
+    {
+        nyx_hist_record(&entry->ack, elapsed);
+
+        if(m_slow_us > 0 && elapsed > m_slow_us)
+        {
+            MG_INFO(("`%s.%s` slow to answer: %lu ms", entry->device, entry->name, (unsigned long) (elapsed / 1000)));
+        }
+
+        entry->acked = true;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* FIRST NON-BUSY UPDATE = COMPLETION                                                                             */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(meta->state == NULL || strcmp(meta->state, "Busy") != 0)
+    {
+        nyx_hist_record(&entry->done, elapsed);
+
+        if(m_slow_us > 0 && elapsed > m_slow_us)
+        {
+            MG_INFO(("`%s.%s` slow to complete: %lu ms", entry->device, entry->name, (unsigned long) (elapsed / 1000)));
+        }
+
+        if(meta->state != NULL && strcmp(meta->state, "Alert") == 0)
+        {
+            entry->alerts++;
+        }
+
+        entry->pending = false;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_tracker_expire(uint64_t now)
+{
+    visit_ctx_t ctx = {
+        .now = now,
+    };
+
+    nyx_string_map_foreach(m_entries, expire_entry, &ctx);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_tracker_foreach(nyx_tracker_visit_fn visit_fn, buff_t arg)
+{
+    visit_ctx_t ctx = {
+        .visit_fn = visit_fn,
+        .arg = arg,
+    };
+
+    nyx_string_map_foreach(m_entries, visit_entry, &ctx);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,216 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#ifdef HAVE_ZLIB
+#  include <zlib.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#  include <zstd.h>
+#endif
+
+#include "bridge.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define MAX_DECOMPRESSED_SIZE (64UL * 1024UL * 1024UL)
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static STR_t NAMES[] = {
+    [NYX_COMPRESS_NONE] = "none",
+    [NYX_COMPRESS_ZLIB] = "zlib",
+    [NYX_COMPRESS_ZSTD] = "zstd",
+};
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int nyx_compress_parse(STR_t name)
+{
+    /**/ if(name == NULL || name[0] == '\0' || strcmp(name, "none") == 0) {
+        return NYX_COMPRESS_NONE;
+    }
+#ifdef HAVE_ZLIB
+    else if(strcmp(name, "zlib") == 0) {
+        return NYX_COMPRESS_ZLIB;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    else if(strcmp(name, "zstd") == 0) {
+        return NYX_COMPRESS_ZSTD;
+    }
+#endif
+    return -1;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+STR_t nyx_compress_name(int algo)
+{
+    return (algo >= NYX_COMPRESS_NONE && algo <= NYX_COMPRESS_ZSTD) ? NAMES[algo] : "none";
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+buff_t nyx_compress(int algo, size_t *result_len, size_t len, BUFF_t buff)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* ZLIB                                                                                                           */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+#ifdef HAVE_ZLIB
+    if(algo == NYX_COMPRESS_ZLIB)
+    {
+        uLongf size = compressBound((uLong) len);
+
+        buff_t result = nyx_memory_alloc(size);
+
+        if(compress2(result, &size, buff, (uLong) len, Z_BEST_SPEED) == Z_OK && size < len)
+        {
+            *result_len = size;
+
+            return result;
+        }
+
+        nyx_memory_free(result);
+    }
+#endif
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* ZSTD                                                                                                           */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+#ifdef HAVE_ZSTD
+    if(algo == NYX_COMPRESS_ZSTD)
+    {
+        size_t size = ZSTD_compressBound(len);
+
+        buff_t result = nyx_memory_alloc(size);
+
+        size = ZSTD_compress(result, size, buff, len, ZSTD_CLEVEL_DEFAULT);
+
+        if(ZSTD_isError(size) == 0 && size < len)
+        {
+            *result_len = size;
+
+            return result;
+        }
+
+        nyx_memory_free(result);
+    }
+#endif
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    (void) algo;
+    (void) result_len;
+    (void) len;
+    (void) buff;
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+buff_t nyx_decompress(int algo, size_t *result_len, size_t len, BUFF_t buff)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* ZLIB                                                                                                           */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+#ifdef HAVE_ZLIB
+    if(algo == NYX_COMPRESS_ZLIB)
+    {
+        z_stream stream = {
+            .next_in = (Bytef *) buff,
+            .avail_in = (uInt) len,
+        };
+
+        if(inflateInit(&stream) != Z_OK)
+        {
+            return NULL;
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        size_t size = 4 * len + 64;
+
+        uint8_t *result = nyx_memory_alloc(size);
+
+        for(;;)
+        {
+            stream.next_out = result + stream.total_out;
+            stream.avail_out = (uInt) (size - stream.total_out);
+
+            int status = inflate(&stream, Z_NO_FLUSH);
+
+            /**/ if(status == Z_STREAM_END)
+            {
+                *result_len = stream.total_out;
+
+                inflateEnd(&stream);
+
+                return result;
+            }
+            else if((status != Z_OK && status != Z_BUF_ERROR) || stream.avail_out != 0 || size >= MAX_DECOMPRESSED_SIZE)
+            {
+                break;
+            }
+
+            result = nyx_memory_realloc(result, size *= 2);
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        inflateEnd(&stream);
+
+        nyx_memory_free(result);
+    }
+#endif
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* ZSTD                                                                                                           */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+#ifdef HAVE_ZSTD
+    if(algo == NYX_COMPRESS_ZSTD)
+    {
+        unsigned long long size = ZSTD_getFrameContentSize(buff, len);
+
+        if(size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN || size > MAX_DECOMPRESSED_SIZE)
+        {
+            return NULL;
+        }
+
+        buff_t result = nyx_memory_alloc((size_t) size + 1);
+
+        size_t n = ZSTD_decompress(result, (size_t) size + 1, buff, len);
+
+        if(ZSTD_isError(n) == 0)
+        {
+            *result_len = n;
+
+            return result;
+        }
+
+        nyx_memory_free(result);
+    }
+#endif
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    (void) algo;
+    (void) result_len;
+    (void) len;
+    (void) buff;
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -5,10 +5,18 @@
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+#include <cctype>
+
 #include "bridge.h"
 
 #include "indi_nyx_driver.hpp"
 
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define STATS_TAB "Statistics"
+
+#define STATS_TIMER_MS 5000
+
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* GLOBAL INSTANCE                                                                                                    */
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -93,6 +101,75 @@ bool IndiNyxDriver::initProperties()
         IPS_IDLE
     );
 
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* LATENCY STATISTICS                                                                                             */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    static const char *const vectors[NYX_METRICS_DIRECTIONS][2] = {
+        {"INDI_TO_MQTT_LATENCY", "INDI to MQTT latency (ms)"},
+        {"MQTT_TO_INDI_LATENCY", "MQTT to INDI latency (ms)"},
+    };
+
+    for(int direction = 0; direction < NYX_METRICS_DIRECTIONS; direction++)
+    {
+        for(int cls = 0; cls < NYX_METRICS_CLASSES; cls++)
+        {
+            const char *class_name = nyx_metrics_class_name(cls);
+
+            char name[MAXINDINAME];
+            char label[MAXINDILABEL];
+
+            for(int i = 0; i < 2; i++)
+            {
+                snprintf(name, sizeof(name), "%s_P%d", class_name, i == 0 ? 50 : 99);
+                snprintf(label, sizeof(label), "%s p%d", class_name, i == 0 ? 50 : 99);
+
+                for(char *p = name; *p != '\0'; p++) *p = (char) toupper(*p);
+
+                IUFillNumber(&LatencyN[direction][2 * cls + i], name, label, "%.3f", 0.0, 1.0e9, 0.0, 0.0);
+            }
+        }
+
+        IUFillNumberVector(
+            &LatencyNP[direction],
+            LatencyN[direction],
+            2 * NYX_METRICS_CLASSES,
+            getDeviceName(),
+            vectors[direction][0],
+            vectors[direction][1],
+            STATS_TAB,
+            IP_RO,
+            60,
+            IPS_IDLE
+        );
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* EVENT LOOP DIAGNOSTICS                                                                                         */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    IUFillNumber(&EventLoopN[0], "ITERATION_P50", "Iteration p50 (ms)", "%.3f", 0.0, 1.0e9, 0.0, 0.0);
+    IUFillNumber(&EventLoopN[1], "ITERATION_P99", "Iteration p99 (ms)", "%.3f", 0.0, 1.0e9, 0.0, 0.0);
+    IUFillNumber(&EventLoopN[2], "ITERATION_MAX", "Iteration max (ms)", "%.3f", 0.0, 1.0e9, 0.0, 0.0);
+    IUFillNumber(&EventLoopN[3], "STALLS", "Stalls", "%.0f", 0.0, 1.0e18, 0.0, 0.0);
+
+    IUFillNumberVector(
+        &EventLoopNP,
+        EventLoopN,
+        4,
+        getDeviceName(),
+        "EVENT_LOOP",
+        "Event loop",
+        STATS_TAB,
+        IP_RO,
+        60,
+        IPS_IDLE
+    );
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    SetTimer(STATS_TIMER_MS);
+
     /*----------------------------------------------------------------------------------------------------------------*/
 
     return true;
@@ -106,6 +183,13 @@ void IndiNyxDriver::ISGetProperties(const char *dev)
 
     defineProperty(&MQTTSettingsTP);
 
+    for(auto &property : LatencyNP)
+    {
+        defineProperty(&property);
+    }
+
+    defineProperty(&EventLoopNP);
+
     /*----------------------------------------------------------------------------------------------------------------*/
 
     loadConfig(true, MQTTSettingsTP.name);
@@ -165,6 +249,74 @@ bool IndiNyxDriver::saveConfigItems(FILE *fp)
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+void IndiNyxDriver::TimerHit()
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_metrics_t metrics;
+
+    nyx_metrics_snapshot(&metrics);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    for(int direction = 0; direction < NYX_METRICS_DIRECTIONS; direction++)
+    {
+        for(int cls = 0; cls < NYX_METRICS_CLASSES; cls++)
+        {
+            const nyx_hist_t *hist = &metrics.hist[direction][cls];
+
+            LatencyN[direction][2 * cls + 0].value = 1.0e-3 * (double) nyx_hist_quantile(hist, 0.50);
+            LatencyN[direction][2 * cls + 1].value = 1.0e-3 * (double) nyx_hist_quantile(hist, 0.99);
+        }
+
+        LatencyNP[direction].s = IPS_OK;
+
+        IDSetNumber(&LatencyNP[direction], nullptr);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* AN ALERT IS RAISED WHEN AN ITERATION WENT OVER BUDGET SINCE THE PREVIOUS TICK                                  */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_watchdog_t watchdog;
+
+    nyx_watchdog_snapshot(&watchdog);
+
+    EventLoopN[0].value = 1.0e-3 * (double) nyx_hist_quantile(&watchdog.iteration, 0.50);
+    EventLoopN[1].value = 1.0e-3 * (double) nyx_hist_quantile(&watchdog.iteration, 0.99);
+    EventLoopN[2].value = 1.0e-3 * (double) watchdog.iteration.max;
+    EventLoopN[3].value = (double) watchdog.stalls;
+
+    if(watchdog.stalls > m_LastStalls)
+    {
+        m_LastStalls = watchdog.stalls;
+
+        EventLoopNP.s = IPS_ALERT;
+
+        IDSetNumber(
+            &EventLoopNP,
+            "Event loop stalled for %.0f ms, %s handler on %zu bytes",
+            1.0e-3 * (double) watchdog.last_stall,
+            nyx_watchdog_handler_name(watchdog.last_stall_handler),
+            watchdog.last_stall_len
+        );
+    }
+    else
+    {
+        EventLoopNP.s = IPS_OK;
+
+        IDSetNumber(&EventLoopNP, nullptr);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    SetTimer(STATS_TIMER_MS);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
 void IndiNyxDriver::workerThreadFunc() const
 {
     /*----------------------------------------------------------------------------------------------------------------*/
@@ -12,6 +12,8 @@
 
 #include <libindi/defaultdevice.h>
 
+#include "bridge.h"
+
 /*--------------------------------------------------------------------------------------------------------------------*/
 
 class IndiNyxDriver : public INDI::DefaultDevice
@@ -36,6 +38,8 @@ public:
 
     bool saveConfigItems(FILE *fp) override;
 
+    void TimerHit() override;
+
     /*----------------------------------------------------------------------------------------------------------------*/
 
 private:
@@ -46,6 +50,18 @@ private:
 
     /*----------------------------------------------------------------------------------------------------------------*/
 
+    INumber               LatencyN[NYX_METRICS_DIRECTIONS][2 * NYX_METRICS_CLASSES]{};
+    INumberVectorProperty LatencyNP[NYX_METRICS_DIRECTIONS]{};
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    INumber               EventLoopN[4]{};
+    INumberVectorProperty EventLoopNP{};
+
+    uint64_t m_LastStalls = 0;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
     std::atomic<bool> m_WorkerRunning = false;
 
     std::thread m_WorkerThread;
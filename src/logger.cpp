@@ -5,7 +5,18 @@
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+#include <cstdio>
+#include <cstdlib>
 #include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
 
 #include <libindi/indilogger.h>
 
@@ -13,36 +24,830 @@
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+#define LOG_SLOTS 1024 /* POWER OF TWO */
+
+#define LOG_SLOT_DATA 1000
+
+#define LOG_LINE_SIZE 4096
+
+#define LOG_TRUNCATE 256UL
+
+#define LOG_RATE 20UL
+
+#define LOG_SITES 64 /* POWER OF TWO */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
 int nyx_curr_log_level = MG_LL_NONE; /* NOSONAR */
 
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* A RECORD HOLDS THE FORMAT (A STRING LITERAL) AND ITS RAW ARGUMENTS, FORMATTING IS DONE BY THE LOGGER THREAD        */
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void __attribute__((format(printf, 1, 2))) nyx_log(const char *fmt, ...)
+typedef struct
 {
-    if(nyx_curr_log_level <= mg_log_level)
+    int level;
+
+    const char *fmt;
+
+    uint64_t suppressed;
+
+    size_t len;
+
+    uint8_t data[LOG_SLOT_DATA];
+
+} record_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    const char *fmt;
+
+    uint64_t window;
+
+    uint64_t count;
+
+    uint64_t suppressed;
+
+} site_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* PLAIN STATIC STORAGE: LOGGING MAY START BEFORE ANY C++ CONSTRUCTOR OF THIS FILE HAS RUN                            */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static record_t m_records[LOG_SLOTS];
+
+static uint64_t m_head = 0;
+static uint64_t m_tail = 0;
+
+static uint64_t m_dropped = 0;
+
+static site_t m_sites[LOG_SITES];
+
+static size_t m_truncate = LOG_TRUNCATE;
+
+static uint64_t m_rate = LOG_RATE;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static pthread_mutex_t m_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_cond_t m_cond = PTHREAD_COND_INITIALIZER;
+
+static pthread_once_t m_once = PTHREAD_ONCE_INIT;
+
+static pthread_t m_thread;
+
+static bool m_running = false;
+
+static bool m_stopping = false;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* FORMAT SPECIFICATIONS                                                                                              */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    char flags[8];
+
+    int width; /* -1: none, -2: '*' */
+
+    int precision; /* -1: none, -2: '*' */
+
+    char length[3];
+
+    char conv;
+
+    const char *end;
+
+} spec_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static const char *parse_spec(spec_t *spec, const char *p)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    size_t n = 0;
+
+    while(*p != '\0' && strchr("-+ #0", *p) != nullptr)
+    {
+        if(n < sizeof(spec->flags) - 1)
+        {
+            spec->flags[n++] = *p;
+        }
+
+        p++;
+    }
+
+    spec->flags[n] = '\0';
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    spec->width = -1;
+
+    if(*p == '*')
+    {
+        spec->width = -2;
+
+        p++;
+    }
+    else
+    {
+        for(; *p >= '0' && *p <= '9'; p++) spec->width = (spec->width < 0 ? 0 : 10 * spec->width) + (*p - '0');
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    spec->precision = -1;
+
+    if(*p == '.')
+    {
+        p++;
+
+        if(*p == '*')
+        {
+            spec->precision = -2;
+
+            p++;
+        }
+        else
+        {
+            for(spec->precision = 0; *p >= '0' && *p <= '9'; p++) spec->precision = 10 * spec->precision + (*p - '0');
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    n = 0;
+
+    while(*p != '\0' && strchr("hlzjtL", *p) != nullptr)
+    {
+        if(n < sizeof(spec->length) - 1)
+        {
+            spec->length[n++] = *p;
+        }
+
+        p++;
+    }
+
+    spec->length[n] = '\0';
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    spec->conv = *p;
+
+    spec->end = *p != '\0' ? p + 1 : p;
+
+    return spec->end;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* CAPTURE (PRODUCER SIDE)                                                                                            */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool put(record_t *record, const void *buff, size_t size)
+{
+    if(record->len + size > LOG_SLOT_DATA)
+    {
+        return false;
+    }
+
+    memcpy(record->data + record->len, buff, size);
+
+    record->len += size;
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool put_u64(record_t *record, uint64_t value)
+{
+    return put(record, &value, sizeof(uint64_t));
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool put_str(record_t *record, const char *s, int precision)
+{
+    if(s == nullptr)
+    {
+        s = "(null)";
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* PAYLOADS ARE NEVER SCANNED PAST THE TRUNCATION LIMIT: WITHOUT PRECISION, THE TOTAL LENGTH IS UNKNOWN (0)       */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint64_t stored;
+    uint64_t total;
+
+    if(precision >= 0 && (size_t) precision > m_truncate)
+    {
+        stored = strnlen(s, m_truncate);
+
+        total = stored == m_truncate ? (uint64_t) precision : stored;
+    }
+    else
+    {
+        stored = strnlen(s, precision >= 0 ? (size_t) precision : m_truncate + 1);
+
+        total = stored > m_truncate ? 0 : stored;
+
+        if(stored > m_truncate)
+        {
+            stored = m_truncate;
+        }
+    }
+
+    if(record->len + 2 * sizeof(uint64_t) + stored > LOG_SLOT_DATA)
+    {
+        size_t room = LOG_SLOT_DATA - record->len;
+
+        stored = room > 2 * sizeof(uint64_t) ? room - 2 * sizeof(uint64_t) : 0;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return put_u64(record, total)
+           &&
+           put_u64(record, stored)
+           &&
+           put(record, s, stored)
+    ;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void capture(record_t *record, const char *fmt, va_list ap)
+{
+    spec_t spec;
+
+    for(const char *p = fmt; (p = strchr(p, '%')) != nullptr;)
+    {
+        p = parse_spec(&spec, p + 1);
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        int precision = spec.precision;
+
+        if(spec.width == -2 && put_u64(record, (uint64_t) (int64_t) va_arg(ap, int)) == false)
+        {
+            return;
+        }
+
+        if(spec.precision == -2 && put_u64(record, (uint64_t) (int64_t) (precision = va_arg(ap, int))) == false)
+        {
+            return;
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        bool ok = true;
+
+        switch(spec.conv)
+        {
+            case 'd':
+            case 'i':
+                /**/ if(strcmp(spec.length, "ll") == 0) ok = put_u64(record, (uint64_t) va_arg(ap, long long));
+                else if(strcmp(spec.length, "l") == 0) ok = put_u64(record, (uint64_t) va_arg(ap, long));
+                else if(strcmp(spec.length, "z") == 0) ok = put_u64(record, (uint64_t) va_arg(ap, ssize_t));
+                else if(strcmp(spec.length, "j") == 0) ok = put_u64(record, (uint64_t) va_arg(ap, intmax_t));
+                else if(strcmp(spec.length, "t") == 0) ok = put_u64(record, (uint64_t) va_arg(ap, ptrdiff_t));
+                else ok = put_u64(record, (uint64_t) (int64_t) va_arg(ap, int));
+                break;
+
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+                /**/ if(strcmp(spec.length, "ll") == 0) ok = put_u64(record, (uint64_t) va_arg(ap, unsigned long long));
+                else if(strcmp(spec.length, "l") == 0) ok = put_u64(record, (uint64_t) va_arg(ap, unsigned long));
+                else if(strcmp(spec.length, "z") == 0) ok = put_u64(record, (uint64_t) va_arg(ap, size_t));
+                else if(strcmp(spec.length, "j") == 0) ok = put_u64(record, (uint64_t) va_arg(ap, uintmax_t));
+                else if(strcmp(spec.length, "t") == 0) ok = put_u64(record, (uint64_t) va_arg(ap, ptrdiff_t));
+                else ok = put_u64(record, (uint64_t) va_arg(ap, unsigned int));
+                break;
+
+            case 'c':
+                ok = put_u64(record, (uint64_t) va_arg(ap, int));
+                break;
+
+            case 'p':
+                ok = put_u64(record, (uint64_t) (uintptr_t) va_arg(ap, void *));
+                break;
+
+            case 'e':
+            case 'E':
+            case 'f':
+            case 'F':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A': {
+                double value = strcmp(spec.length, "L") == 0 ? (double) va_arg(ap, long double) : va_arg(ap, double);
+                ok = put(record, &value, sizeof(double));
+                break;
+            }
+
+            case 's':
+                ok = put_str(record, va_arg(ap, const char *), precision);
+                break;
+
+            case 'n':
+                (void) va_arg(ap, void *);
+                break;
+
+            default:
+                break;
+        }
+
+        if(ok == false)
+        {
+            return;
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* RENDERING (LOGGER THREAD SIDE)                                                                                     */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    const record_t *record;
+
+    size_t offset;
+
+} reader_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool get(reader_t *reader, void *buff, size_t size)
+{
+    if(reader->offset + size > reader->record->len)
+    {
+        return false;
+    }
+
+    memcpy(buff, reader->record->data + reader->offset, size);
+
+    reader->offset += size;
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static size_t append(char *line, size_t pos, const char *fmt, ...)
+{
+    if(pos >= LOG_LINE_SIZE - 1)
+    {
+        return pos;
+    }
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line + pos, LOG_LINE_SIZE - pos, fmt, ap);
+    va_end(ap);
+
+    return n < 0 ? pos : pos + (size_t) n < LOG_LINE_SIZE - 1 ? pos + (size_t) n : LOG_LINE_SIZE - 1;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void render(char *line, const record_t *record)
+{
+    reader_t reader = {record, 0};
+
+    size_t pos = 0;
+
+    spec_t spec;
+
+    char conv[32];
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    for(const char *p = record->fmt; *p != '\0';)
     {
-        std::string buff;
+        /*------------------------------------------------------------------------------------------------------------*/
+        /* LITERAL TEXT                                                                                               */
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        const char *q = strchr(p, '%');
+
+        if(q == nullptr)
+        {
+            pos = append(line, pos, "%s", p);
+
+            break;
+        }
+
+        pos = append(line, pos, "%.*s", (int) (q - p), p);
+
+        p = parse_spec(&spec, q + 1);
+
+        if(spec.conv == '%')
+        {
+            pos = append(line, pos, "%%");
+
+            continue;
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+        /* STARS ARE RESOLVED INTO LITERAL WIDTH / PRECISION                                                          */
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        uint64_t value;
+
+        int width = spec.width;
+        int precision = spec.precision;
 
-        buff.resize(4096);
+        if(width == -2)
+        {
+            if(get(&reader, &value, sizeof(uint64_t)) == false) goto __truncated;
+
+            width = (int) (int64_t) value;
+        }
+
+        if(precision == -2)
+        {
+            if(get(&reader, &value, sizeof(uint64_t)) == false) goto __truncated;
+
+            precision = (int) (int64_t) value;
+        }
 
         /*------------------------------------------------------------------------------------------------------------*/
 
-        va_list ap;
-        va_start(ap, fmt);
-        vsnprintf(buff.data(), buff.size(), fmt, ap);
-        va_end(ap);
+        int n = snprintf(conv, sizeof(conv), "%%%s", spec.flags);
+
+        if(width >= 0)
+        {
+            n += snprintf(conv + n, sizeof(conv) - n, "%d", width);
+        }
+
+        if(precision >= 0 && spec.conv != 's')
+        {
+            n += snprintf(conv + n, sizeof(conv) - n, ".%d", precision);
+        }
 
         /*------------------------------------------------------------------------------------------------------------*/
 
-        switch(nyx_curr_log_level)
+        switch(spec.conv)
         {
-            case MG_LL_ERROR:   IDLog("[Bridge][ERROR] %s\n", buff.c_str());   break;
-            case MG_LL_INFO:    IDLog("[Bridge][INFO] %s\n", buff.c_str());    break;
-            case MG_LL_DEBUG:   IDLog("[Bridge][DEBUG] %s\n", buff.c_str());   break;
-            case MG_LL_VERBOSE: IDLog("[Bridge][VERBOSE] %s\n", buff.c_str()); break;
+            case 'd':
+            case 'i':
+                if(get(&reader, &value, sizeof(uint64_t)) == false) goto __truncated;
+                snprintf(conv + n, sizeof(conv) - n, "ll%c", spec.conv);
+                pos = append(line, pos, conv, (long long) (int64_t) value);
+                break;
+
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+                if(get(&reader, &value, sizeof(uint64_t)) == false) goto __truncated;
+                snprintf(conv + n, sizeof(conv) - n, "ll%c", spec.conv);
+                pos = append(line, pos, conv, (unsigned long long) value);
+                break;
+
+            case 'c':
+                if(get(&reader, &value, sizeof(uint64_t)) == false) goto __truncated;
+                snprintf(conv + n, sizeof(conv) - n, "c");
+                pos = append(line, pos, conv, (int) value);
+                break;
+
+            case 'p':
+                if(get(&reader, &value, sizeof(uint64_t)) == false) goto __truncated;
+                snprintf(conv + n, sizeof(conv) - n, "p");
+                pos = append(line, pos, conv, (void *) (uintptr_t) value);
+                break;
+
+            case 'e':
+            case 'E':
+            case 'f':
+            case 'F':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A': {
+                double d;
+                if(get(&reader, &d, sizeof(double)) == false) goto __truncated;
+                snprintf(conv + n, sizeof(conv) - n, "%c", spec.conv);
+                pos = append(line, pos, conv, d);
+                break;
+            }
+
+            case 's': {
+                uint64_t total;
+                uint64_t stored;
+                if(get(&reader, &total, sizeof(uint64_t)) == false
+                   ||
+                   get(&reader, &stored, sizeof(uint64_t)) == false
+                   ||
+                   reader.offset + stored > record->len
+                ) {
+                    goto __truncated;
+                }
+                snprintf(conv + n, sizeof(conv) - n, ".*s");
+                pos = append(line, pos, conv, (int) stored, (const char *) record->data + reader.offset);
+                reader.offset += stored;
+                /**/ if(total == 0 && stored > 0) {
+                    pos = append(line, pos, "...");
+                }
+                else if(total > stored) {
+                    pos = append(line, pos, "... (%llu bytes)", (unsigned long long) total);
+                }
+                break;
+            }
+
             default:
                 break;
         }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(record->suppressed > 0)
+    {
+        append(line, pos, " (%llu similar messages suppressed)", (unsigned long long) record->suppressed);
+    }
+
+    return;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+__truncated:
+    append(line, pos, "...");
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void write_line(int level, const char *line)
+{
+    switch(level)
+    {
+        case MG_LL_ERROR:   IDLog("[Bridge][ERROR] %s\n", line);   break;
+        case MG_LL_INFO:    IDLog("[Bridge][INFO] %s\n", line);    break;
+        case MG_LL_DEBUG:   IDLog("[Bridge][DEBUG] %s\n", line);   break;
+        case MG_LL_VERBOSE: IDLog("[Bridge][VERBOSE] %s\n", line); break;
+        default:
+            break;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* LOGGER THREAD                                                                                                      */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void *logger_thread(void *)
+{
+    static char line[LOG_LINE_SIZE];
+
+    pthread_mutex_lock(&m_mutex);
+
+    for(;;)
+    {
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        while(m_tail == m_head && m_dropped == 0 && m_stopping == false)
+        {
+            pthread_cond_wait(&m_cond, &m_mutex);
+        }
+
+        if(m_tail == m_head && m_dropped == 0)
+        {
+            break;
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        uint64_t dropped = m_dropped;
+
+        m_dropped = 0;
+
+        uint64_t head = m_head;
+
+        pthread_mutex_unlock(&m_mutex);
+
+        /*------------------------------------------------------------------------------------------------------------*/
+        /* SLOTS BETWEEN TAIL AND HEAD ARE NOT TOUCHED BY PRODUCERS UNTIL THE TAIL MOVES                              */
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        if(dropped > 0)
+        {
+            snprintf(line, sizeof(line), "%llu log messages dropped (queue full)", (unsigned long long) dropped);
+
+            write_line(MG_LL_ERROR, line);
+        }
+
+        for(uint64_t i = m_tail; i < head; i++)
+        {
+            const record_t *record = &m_records[i & (LOG_SLOTS - 1)];
+
+            line[0] = '\0';
+
+            render(line, record);
+
+            write_line(record->level, line);
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        pthread_mutex_lock(&m_mutex);
+
+        m_tail = head;
+    }
+
+    pthread_mutex_unlock(&m_mutex);
+
+    return nullptr;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void logger_stop()
+{
+    pthread_mutex_lock(&m_mutex);
+
+    m_stopping = true;
+
+    pthread_cond_signal(&m_cond);
+
+    pthread_mutex_unlock(&m_mutex);
+
+    pthread_join(m_thread, nullptr);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void logger_start()
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    const char *env;
+
+    if((env = getenv("NYX_LOG_TRUNCATE")) != nullptr && env[0] != '\0')
+    {
+        m_truncate = strtoul(env, nullptr, 10);
+    }
+
+    if((env = getenv("NYX_LOG_RATE")) != nullptr && env[0] != '\0')
+    {
+        m_rate = strtoul(env, nullptr, 10);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* THE FIRST MESSAGE MAY COME FROM THE PINNED SCHED_FIFO BRIDGE THREAD, THE LOGGER MUST INHERIT NEITHER           */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    pthread_attr_t attr;
+
+    pthread_attr_init(&attr);
+
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+
+    pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+
+    struct sched_param param = {};
+
+    pthread_attr_setschedparam(&attr, &param);
+
+    cpu_set_t set;
+
+    if(sched_getaffinity(getpid(), sizeof(set), &set) == 0)
+    {
+        pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(pthread_create(&m_thread, &attr, logger_thread, nullptr) == 0)
+    {
+        m_running = true;
+
+        atexit(logger_stop);
+    }
+
+    pthread_attr_destroy(&attr);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* RATE LIMITING, PER CALL SITE (FORMAT STRING) AND PER SECOND                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool rate_limit(const char *fmt, uint64_t *suppressed)
+{
+    if(m_rate == 0)
+    {
+        return true;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+
+    uint64_t window = (uint64_t) ts.tv_sec;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    size_t idx = ((uintptr_t) fmt >> 3) & (LOG_SITES - 1);
+
+    site_t *site = &m_sites[idx];
+
+    if(site->fmt != fmt || site->window != window)
+    {
+        *suppressed = site->fmt == fmt ? site->suppressed : 0;
+
+        site->fmt = fmt;
+        site->window = window;
+        site->count = 0;
+        site->suppressed = 0;
+    }
+
+    if(site->count >= m_rate)
+    {
+        site->suppressed++;
+
+        return false;
+    }
+
+    site->count++;
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void __attribute__((format(printf, 1, 2))) nyx_log(const char *fmt, ...)
+{
+    if(nyx_curr_log_level <= mg_log_level)
+    {
+        pthread_once(&m_once, logger_start);
+
+        pthread_mutex_lock(&m_mutex);
+
+        /*------------------------------------------------------------------------------------------------------------*/
+        /* SYNCHRONOUS FALLBACK, E.G. WHILE THE PROCESS IS EXITING                                                    */
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        if(m_running == false || m_stopping)
+        {
+            pthread_mutex_unlock(&m_mutex);
+
+            char line[LOG_LINE_SIZE];
+
+            va_list ap;
+            va_start(ap, fmt);
+            vsnprintf(line, sizeof(line), fmt, ap);
+            va_end(ap);
+
+            write_line(nyx_curr_log_level, line);
+
+            return;
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        uint64_t suppressed = 0;
+
+        if(rate_limit(fmt, &suppressed))
+        {
+            if(m_head - m_tail < LOG_SLOTS)
+            {
+                record_t *record = &m_records[m_head & (LOG_SLOTS - 1)];
+
+                record->level = nyx_curr_log_level;
+                record->fmt = fmt;
+                record->suppressed = suppressed;
+                record->len = 0;
+
+                va_list ap;
+                va_start(ap, fmt);
+                capture(record, fmt, ap);
+                va_end(ap);
+
+                m_head++;
+
+                pthread_cond_signal(&m_cond);
+            }
+            else
+            {
+                m_dropped++;
+            }
+        }
+
+        pthread_mutex_unlock(&m_mutex);
 
         /*------------------------------------------------------------------------------------------------------------*/
     }
@@ -6,6 +6,17 @@
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+static nyx_memory_stats_t m_stats = {0};
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_memory_get_stats(nyx_memory_stats_t *result)
+{
+    *result = m_stats;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
 size_t nyx_memory_free(buff_t buff)
 {
     if(buff == NULL)
@@ -13,6 +24,8 @@ size_t nyx_memory_free(buff_t buff)
         return 0x00;
     }
 
+    m_stats.frees++;
+
     /*----------------------------------------------------------------------------------------------------------------*/
 
 #ifdef HAVE_MALLOC_SIZE
@@ -56,6 +69,10 @@ buff_t nyx_memory_alloc(size_t size)
         exit(1);
     }
 
+    m_stats.allocs++;
+
+    m_stats.bytes += size;
+
     /*----------------------------------------------------------------------------------------------------------------*/
 
     return result;
@@ -84,6 +101,8 @@ buff_t nyx_memory_realloc(buff_t buff, size_t size)
         exit(1);
     }
 
+    m_stats.bytes += size;
+
     /*----------------------------------------------------------------------------------------------------------------*/
 
     return result;
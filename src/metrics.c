@@ -0,0 +1,283 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "bridge.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* LOG-LINEAR BUCKETS: VALUES BELOW 2^LINEAR_BITS ARE EXACT, EACH FOLLOWING OCTAVE IS SPLIT INTO 2^SUB_BITS BUCKETS   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define SUB_BITS 3
+
+#define LINEAR_BITS 4
+
+#define MAX_VALUE ((UINT64_C(1) << (LINEAR_BITS + (NYX_HIST_BUCKETS - (1 << LINEAR_BITS)) / (1 << SUB_BITS))) - 1)
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static STR_t DIRECTION_NAMES[NYX_METRICS_DIRECTIONS] = {
+    [NYX_METRICS_INDI_TO_MQTT] = "indi_to_mqtt",
+    [NYX_METRICS_MQTT_TO_INDI] = "mqtt_to_indi",
+};
+
+static STR_t CLASS_NAMES[NYX_METRICS_CLASSES] = {
+    [NYX_METRICS_DEF] = "def",
+    [NYX_METRICS_SET] = "set",
+    [NYX_METRICS_NEW] = "new",
+    [NYX_METRICS_BLOB] = "blob",
+    [NYX_METRICS_OTHER] = "other",
+};
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static nyx_metrics_t m_live = {0};
+
+static nyx_metrics_t m_snapshot = {0};
+
+static nyx_metrics_t m_cumulative = {0};
+
+static pthread_mutex_t m_snapshot_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* HISTOGRAM                                                                                                          */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static size_t bucket_of(uint64_t value)
+{
+    if(value < (1 << LINEAR_BITS))
+    {
+        return (size_t) value;
+    }
+
+    if(value > MAX_VALUE)
+    {
+        return NYX_HIST_BUCKETS - 1;
+    }
+
+    int octave = 63 - __builtin_clzll(value);
+
+    size_t sub = (size_t) (value >> (octave - SUB_BITS)) & ((1 << SUB_BITS) - 1);
+
+    return (1 << LINEAR_BITS) + ((size_t) (octave - LINEAR_BITS) << SUB_BITS) + sub;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static uint64_t bucket_upper_bound(size_t bucket)
+{
+    if(bucket < (1 << LINEAR_BITS))
+    {
+        return (uint64_t) bucket;
+    }
+
+    int octave = (int) ((bucket - (1 << LINEAR_BITS)) >> SUB_BITS) + LINEAR_BITS;
+
+    uint64_t sub = (bucket - (1 << LINEAR_BITS)) & ((1 << SUB_BITS) - 1);
+
+    return (((1 << SUB_BITS) + sub + 1) << (octave - SUB_BITS)) - 1;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_hist_record(nyx_hist_t *hist, uint64_t value)
+{
+    hist->buckets[bucket_of(value)]++;
+
+    hist->count++;
+
+    hist->sum += value;
+
+    if(hist->max < value)
+    {
+        hist->max = value;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+uint64_t nyx_hist_quantile(const nyx_hist_t *hist, double q)
+{
+    if(hist->count == 0)
+    {
+        return 0;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint64_t rank = (uint64_t) (q * (double) hist->count);
+
+    if(rank >= hist->count)
+    {
+        rank = hist->count - 1;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint64_t seen = 0;
+
+    for(size_t i = 0; i < NYX_HIST_BUCKETS; i++)
+    {
+        seen += hist->buckets[i];
+
+        if(seen > rank)
+        {
+            uint64_t result = bucket_upper_bound(i);
+
+            return result < hist->max ? result : hist->max;
+        }
+    }
+
+    return hist->max;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* METRICS                                                                                                            */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+uint64_t nyx_metrics_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000ULL + (uint64_t) ts.tv_nsec / 1000ULL;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int nyx_metrics_class(STR_t tag)
+{
+    if(tag == NULL)
+    {
+        return NYX_METRICS_OTHER;
+    }
+
+    /**/ if(strstr(tag, "BLOB") != NULL && strcmp(tag, "enableBLOB") != 0) {
+        return NYX_METRICS_BLOB;
+    }
+    else if(strncmp(tag, "def", 3) == 0) {
+        return NYX_METRICS_DEF;
+    }
+    else if(strncmp(tag, "set", 3) == 0) {
+        return NYX_METRICS_SET;
+    }
+    else if(strncmp(tag, "new", 3) == 0) {
+        return NYX_METRICS_NEW;
+    }
+
+    return NYX_METRICS_OTHER;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+STR_t nyx_metrics_class_name(int cls)
+{
+    return (cls >= 0 && cls < NYX_METRICS_CLASSES) ? CLASS_NAMES[cls] : "other";
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_metrics_record(int direction, int cls, uint64_t start)
+{
+    uint64_t now = nyx_metrics_now();
+
+    uint64_t value = now > start ? now - start : 0;
+
+    nyx_hist_record(&m_live.hist[direction][cls], value);
+
+    nyx_hist_record(&m_cumulative.hist[direction][cls], value);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_metrics_rotate(void)
+{
+    pthread_mutex_lock(&m_snapshot_mutex);
+
+    memcpy(&m_snapshot, &m_live, sizeof(nyx_metrics_t));
+
+    pthread_mutex_unlock(&m_snapshot_mutex);
+
+    memset(&m_live, 0x00, sizeof(nyx_metrics_t));
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_metrics_snapshot(nyx_metrics_t *result)
+{
+    pthread_mutex_lock(&m_snapshot_mutex);
+
+    memcpy(result, &m_snapshot, sizeof(nyx_metrics_t));
+
+    pthread_mutex_unlock(&m_snapshot_mutex);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+const nyx_metrics_t *nyx_metrics_cumulative(void)
+{
+    return &m_cumulative;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+str_t nyx_metrics_to_json(const nyx_metrics_t *metrics)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    char buff[256];
+
+    nyx_string_builder_t *sb = nyx_string_builder_from(NYX_SB_NO_ESCAPE, "{");
+
+    for(int direction = 0; direction < NYX_METRICS_DIRECTIONS; direction++)
+    {
+        nyx_string_builder_append(sb, NYX_SB_NO_ESCAPE, direction > 0 ? ",\"" : "\"", DIRECTION_NAMES[direction]);
+
+        nyx_string_builder_append(sb, NYX_SB_NO_ESCAPE, "\":{");
+
+        for(int cls = 0; cls < NYX_METRICS_CLASSES; cls++)
+        {
+            const nyx_hist_t *hist = &metrics->hist[direction][cls];
+
+            snprintf(buff, sizeof(buff),
+                "%s\"%s\":{\"count\":%llu,\"mean_us\":%llu,\"p50_us\":%llu,\"p90_us\":%llu,\"p99_us\":%llu,"
+                "\"max_us\":%llu}",
+                cls > 0 ? "," : "",
+                CLASS_NAMES[cls],
+                (unsigned long long) hist->count,
+                (unsigned long long) (hist->count > 0 ? hist->sum / hist->count : 0),
+                (unsigned long long) nyx_hist_quantile(hist, 0.50),
+                (unsigned long long) nyx_hist_quantile(hist, 0.90),
+                (unsigned long long) nyx_hist_quantile(hist, 0.99),
+                (unsigned long long) hist->max
+            );
+
+            nyx_string_builder_append(sb, NYX_SB_NO_ESCAPE, buff);
+        }
+
+        nyx_string_builder_append(sb, NYX_SB_NO_ESCAPE, "}");
+    }
+
+    nyx_string_builder_append(sb, NYX_SB_NO_ESCAPE, "}");
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    str_t result = nyx_string_builder_to_string(sb);
+
+    nyx_string_builder_free(sb);
+
+    return result;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
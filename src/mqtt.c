@@ -0,0 +1,641 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "external/mongoose.h"
+
+#include "bridge.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    uint16_t alias_max;
+
+    uint16_t alias_sent;
+
+    uint32_t inflight;
+
+} mqtt_state_t;
+
+_Static_assert(sizeof(mqtt_state_t) <= MG_DATA_SIZE, "mqtt_state_t does not fit in mg_connection::data");
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static uint32_t m_message_expiry = 0;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static mqtt_state_t *get_state(struct mg_connection *connection)
+{
+    return (mqtt_state_t *) connection->data;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static size_t decode_varint(const uint8_t *buff, size_t size, size_t *value)
+{
+    *value = 0;
+
+    for(size_t i = 0, multiplier = 1; i < 4 && i < size; i++, multiplier *= 128)
+    {
+        *value += (buff[i] & 0x7F) * multiplier;
+
+        if((buff[i] & 0x80) == 0)
+        {
+            return i + 1;
+        }
+    }
+
+    return 0;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool is_telemetry(STR_t tag)
+{
+    return tag != NULL && (strncmp(tag, "set", 3) == 0 || strcmp(tag, "message") == 0);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_mqtt_set_message_expiry(uint32_t seconds)
+{
+    m_message_expiry = seconds;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool nyx_mqtt_open(struct mg_connection *connection, const struct mg_mqtt_message *connack)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    mqtt_state_t *state = get_state(connection);
+
+    memset(state, 0x00, sizeof(mqtt_state_t));
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(connack == NULL || connack->cmd != MQTT_CMD_CONNACK)
+    {
+        return false;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* CONNACK = HEADER, REMAINING LENGTH, FLAGS (SESSION PRESENT), REASON CODE, PROPERTY LENGTH, PROPERTIES          */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    const uint8_t *buff = (const uint8_t *) connack->dgram.buf;
+    size_t size = connack->dgram.len;
+
+    size_t remaining_len;
+    size_t props_size;
+
+    size_t n1 = decode_varint(buff + 1, size - 1, &remaining_len);
+
+    if(n1 == 0 || 1 + n1 + 2 > size)
+    {
+        return false;
+    }
+
+    bool result = (buff[1 + n1] & 0x01) != 0;
+
+    if(connection->is_mqtt5 == 0 || 1 + n1 + 2 == size)
+    {
+        return result;
+    }
+
+    size_t n2 = decode_varint(buff + 1 + n1 + 2, size - 1 - n1 - 2, &props_size);
+
+    if(n2 == 0)
+    {
+        return result;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    struct mg_mqtt_message message = *connack;
+
+    message.props_start = 1 + n1 + 2 + n2;
+    message.props_size = props_size;
+
+    if(message.props_start + message.props_size > size)
+    {
+        return result;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    struct mg_mqtt_prop prop;
+
+    for(size_t offset = 0; offset < props_size && (offset = mg_mqtt_next_prop(&message, &prop, offset)) != 0;)
+    {
+        if(prop.id == MQTT_PROP_TOPIC_ALIAS_MAXIMUM)
+        {
+            state->alias_max = (uint16_t) prop.iv;
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    MG_DEBUG(("%lu MQTT topic alias maximum: %u", connection->id, state->alias_max));
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return result;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static uint16_t mqtt_pub(struct mg_connection *connection, STR_t topic, uint16_t alias, const nyx_meta_t *meta, size_t len, BUFF_t buff, uint8_t qos, uint16_t retransmit_id)
+{
+    struct mg_mqtt_opts opts = {
+        .topic = mg_str(topic),
+        .message = mg_str_n(buff, len),
+        .qos = qos,
+        .retransmit_id = retransmit_id,
+    };
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    mqtt_state_t *state = get_state(connection);
+
+    if(qos > 0)
+    {
+        state->inflight++;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(connection->is_mqtt5 == 0)
+    {
+        return mg_mqtt_pub(connection, &opts);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    struct mg_mqtt_prop props[5];
+
+    size_t num_props = 0;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* TOPIC ALIAS                                                                                                    */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(alias > 0 && alias <= state->alias_max && alias <= 16)
+    {
+        uint16_t mask = (uint16_t) (1U << (alias - 1));
+
+        if((state->alias_sent & mask) != 0)
+        {
+            opts.topic = mg_str("");
+        }
+        else
+        {
+            state->alias_sent |= mask;
+        }
+
+        props[num_props++] = (struct mg_mqtt_prop) {.id = MQTT_PROP_TOPIC_ALIAS, .iv = alias};
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* MESSAGE EXPIRY                                                                                                 */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(m_message_expiry > 0 && meta != NULL && is_telemetry(meta->tag))
+    {
+        props[num_props++] = (struct mg_mqtt_prop) {.id = MQTT_PROP_MESSAGE_EXPIRY_INTERVAL, .iv = m_message_expiry};
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* USER PROPERTIES                                                                                                */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(meta != NULL)
+    {
+        if(meta->device != NULL && meta->device[0] != '\0') {
+            props[num_props++] = (struct mg_mqtt_prop) {.id = MQTT_PROP_USER_PROPERTY, .key = mg_str("device"), .val = mg_str(meta->device)};
+        }
+
+        if(meta->name != NULL && meta->name[0] != '\0') {
+            props[num_props++] = (struct mg_mqtt_prop) {.id = MQTT_PROP_USER_PROPERTY, .key = mg_str("property"), .val = mg_str(meta->name)};
+        }
+
+        if(meta->tag != NULL && meta->tag[0] != '\0') {
+            props[num_props++] = (struct mg_mqtt_prop) {.id = MQTT_PROP_USER_PROPERTY, .key = mg_str("tag"), .val = mg_str(meta->tag)};
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    opts.props = props;
+    opts.num_props = num_props;
+
+    return mg_mqtt_pub(connection, &opts);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+uint16_t nyx_mqtt_pub(
+    struct mg_connection *connection,
+    STR_t topic,
+    uint16_t alias,
+    const nyx_meta_t *meta,
+    size_t len,
+    BUFF_t buff,
+    uint8_t qos
+) {
+    return mqtt_pub(connection, topic, alias, meta, len, buff, qos, 0);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_mqtt_ack(struct mg_connection *connection, const struct mg_mqtt_message *message)
+{
+    mqtt_state_t *state = get_state(connection);
+
+    if((message->cmd == MQTT_CMD_PUBACK || message->cmd == MQTT_CMD_PUBCOMP) && state->inflight > 0)
+    {
+        state->inflight--;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+uint32_t nyx_mqtt_inflight(const struct mg_connection *connection)
+{
+    return ((const mqtt_state_t *) connection->data)->inflight;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* PERSISTENT SESSION                                                                                                 */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define MAX_INBOUND 64
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct entry_s
+{
+    uint16_t id;
+
+    uint8_t qos;
+
+    bool released;
+
+    unsigned long connection_id;
+
+    str_t topic;
+
+    uint16_t alias;
+
+    str_t tag;
+    str_t device;
+    str_t name;
+
+    size_t len;
+
+    buff_t buff;
+
+    struct entry_s *next;
+
+} entry_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+struct nyx_mqtt_session_s
+{
+    entry_t *head;
+    entry_t *tail;
+
+    size_t max_bytes;
+
+    size_t bytes;
+
+    size_t inbound_cnt;
+
+    uint16_t inbound[MAX_INBOUND];
+
+    nyx_mqtt_session_stats_t stats;
+};
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void entry_free(entry_t *entry)
+{
+    nyx_memory_free(entry->topic);
+    nyx_memory_free(entry->tag);
+    nyx_memory_free(entry->device);
+    nyx_memory_free(entry->name);
+    nyx_memory_free(entry->buff);
+
+    nyx_memory_free(entry);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static str_t dup_or_null(STR_t s)
+{
+    return s != NULL ? nyx_string_dup(s) : NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void entry_send(struct mg_connection *connection, entry_t *entry, bool retransmit)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* A QOS 2 PUBLISH ALREADY RECEIVED (PUBREC) ONLY NEEDS ITS PUBREL AGAIN                                          */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(entry->released)
+    {
+        uint16_t id = mg_htons(entry->id);
+
+        mg_mqtt_send_header(connection, MQTT_CMD_PUBREL, 2, sizeof(id));
+
+        mg_send(connection, &id, sizeof(id));
+    }
+    else
+    {
+        const nyx_meta_t meta = {
+            .tag = entry->tag,
+            .device = entry->device,
+            .name = entry->name,
+        };
+
+        entry->id = mqtt_pub(connection, entry->topic, entry->alias, &meta, entry->len, entry->buff, entry->qos, retransmit ? entry->id : 0);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    entry->connection_id = connection->id;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+nyx_mqtt_session_t *nyx_mqtt_session_new(size_t max_bytes)
+{
+    nyx_mqtt_session_t *result = nyx_memory_alloc(sizeof(nyx_mqtt_session_t));
+
+    memset(result, 0x00, sizeof(nyx_mqtt_session_t));
+
+    result->max_bytes = max_bytes;
+
+    return result;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_mqtt_session_free(nyx_mqtt_session_t *session)
+{
+    if(session != NULL)
+    {
+        for(entry_t *entry = session->head, *next; entry != NULL; entry = next)
+        {
+            next = entry->next;
+
+            entry_free(entry);
+        }
+
+        nyx_memory_free(session);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_mqtt_session_pub(
+    nyx_mqtt_session_t *session,
+    struct mg_connection *connection,
+    STR_t topic,
+    uint16_t alias,
+    const nyx_meta_t *meta,
+    size_t len,
+    BUFF_t buff,
+    uint8_t qos
+) {
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(qos == 0 || session->bytes + len > session->max_bytes)
+    {
+        if(qos > 0)
+        {
+            session->stats.untracked++;
+        }
+
+        nyx_mqtt_pub(connection, topic, alias, meta, len, buff, qos);
+
+        return;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* KEEP A COPY UNTIL THE BROKER ACKNOWLEDGES IT, IN ORDER TO RESEND IT ON THE NEXT CONNECTION                     */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    entry_t *entry = nyx_memory_alloc(sizeof(entry_t));
+
+    memset(entry, 0x00, sizeof(entry_t));
+
+    entry->qos = qos;
+    entry->topic = nyx_string_dup(topic);
+    entry->alias = alias;
+
+    if(meta != NULL)
+    {
+        entry->tag = dup_or_null(meta->tag);
+        entry->device = dup_or_null(meta->device);
+        entry->name = dup_or_null(meta->name);
+    }
+
+    entry->len = len;
+    entry->buff = nyx_memory_alloc(len > 0 ? len : 1);
+
+    memcpy(entry->buff, buff, len);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(session->tail != NULL)
+    {
+        session->tail->next = entry;
+    }
+    else
+    {
+        session->head = entry;
+    }
+
+    session->tail = entry;
+
+    session->bytes += len;
+
+    session->stats.inflight++;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    entry_send(connection, entry, false);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_mqtt_session_ack(nyx_mqtt_session_t *session, const struct mg_mqtt_message *message)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* INBOUND: THE BROKER RELEASED A QOS 2 MESSAGE, ITS PACKET IDENTIFIER CAN BE REUSED                              */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(message->cmd == MQTT_CMD_PUBREL)
+    {
+        for(size_t i = 0; i < session->inbound_cnt; i++)
+        {
+            if(session->inbound[i] == message->id)
+            {
+                session->inbound[i] = session->inbound[--session->inbound_cnt];
+
+                break;
+            }
+        }
+
+        return;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* OUTBOUND: PUBACK (QOS 1) AND PUBCOMP (QOS 2) COMPLETE A PUBLISH, PUBREC (QOS 2) RELEASES IT                    */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(message->cmd != MQTT_CMD_PUBACK && message->cmd != MQTT_CMD_PUBREC && message->cmd != MQTT_CMD_PUBCOMP)
+    {
+        return;
+    }
+
+    for(entry_t *prev = NULL, *entry = session->head; entry != NULL; prev = entry, entry = entry->next)
+    {
+        if(entry->id == message->id)
+        {
+            if(message->cmd == MQTT_CMD_PUBREC)
+            {
+                entry->released = true;
+
+                return;
+            }
+
+            /*--------------------------------------------------------------------------------------------------------*/
+
+            if(prev != NULL)
+            {
+                prev->next = entry->next;
+            }
+            else
+            {
+                session->head = entry->next;
+            }
+
+            if(session->tail == entry)
+            {
+                session->tail = prev;
+            }
+
+            session->bytes -= entry->len;
+
+            session->stats.inflight--;
+
+            entry_free(entry);
+
+            return;
+
+            /*--------------------------------------------------------------------------------------------------------*/
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool nyx_mqtt_session_accept(nyx_mqtt_session_t *session, const struct mg_mqtt_message *message)
+{
+    if(message->qos != 2)
+    {
+        return true;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* A QOS 2 MESSAGE REDELIVERED BEFORE ITS PUBREL IS A DUPLICATE (E.G. OUR PUBREC WAS LOST WITH THE CONNECTION)    */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    for(size_t i = 0; i < session->inbound_cnt; i++)
+    {
+        if(session->inbound[i] == message->id)
+        {
+            session->stats.duplicates++;
+
+            return false;
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(session->inbound_cnt < MAX_INBOUND)
+    {
+        session->inbound[session->inbound_cnt++] = message->id;
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_mqtt_session_resume(nyx_mqtt_session_t *session, struct mg_connection *connection, bool present)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* THE BROKER LOST THE SESSION (E.G. IT RESTARTED): NOTHING IS IN FLIGHT ANYMORE, BOTH WAYS                       */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(present == false)
+    {
+        session->inbound_cnt = 0;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* RESEND, IN ORDER, WHAT WAS NOT ACKNOWLEDGED ON A PREVIOUS CONNECTION                                           */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    size_t count = 0;
+
+    for(entry_t *entry = session->head; entry != NULL; entry = entry->next)
+    {
+        if(entry->connection_id != connection->id)
+        {
+            if(present == false)
+            {
+                entry->released = false;
+            }
+
+            entry_send(connection, entry, present);
+
+            count++;
+        }
+    }
+
+    session->stats.retransmitted += count;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(count > 0)
+    {
+        MG_INFO(("%lu MQTT resent %lu unacknowledged messages (session %s)", connection->id, (unsigned long) count, present ? "resumed" : "lost"));
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_mqtt_session_get_stats(const nyx_mqtt_session_t *session, nyx_mqtt_session_stats_t *result)
+{
+    memcpy(result, &session->stats, sizeof(nyx_mqtt_session_stats_t));
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -1,158 +1,212 @@
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-#include <regex.h>
+#include <fcntl.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/un.h>
+#include <sys/socket.h>
 
 #include "bridge.h"
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-static str_t read_entire_file(STR_t path)
+static char indiserver_url[128];
+
+#define DEFAULT_INDI_PORT 7624
+
+#define DEFAULT_INDI_SOCKET "/tmp/indiserver"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int nyx_unix_connect(STR_t path)
 {
     /*----------------------------------------------------------------------------------------------------------------*/
 
-    FILE *fp = fopen(path, "rb");
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
 
-    if(fp == NULL)
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* '@' DENOTES A LINUX ABSTRACT SOCKET, AS USED BY INDISERVER                                                     */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    size_t len = strlen(path);
+
+    if(len == 0 || len >= sizeof(addr.sun_path))
     {
-        return NULL;
+        return -1;
     }
 
-    /*----------------------------------------------------------------------------------------------------------------*/
+    memcpy(addr.sun_path, path, len);
 
-    nyx_string_builder_t *sb = nyx_string_builder_new();
+    if(path[0] == '@')
+    {
+        addr.sun_path[0] = '\0';
+    }
 
     /*----------------------------------------------------------------------------------------------------------------*/
 
-    char chunk[4096];
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
 
-    size_t n;
+    if(fd < 0)
+    {
+        return -1;
+    }
 
-    do
+    if(connect(fd, (struct sockaddr *) &addr, (socklen_t) (offsetof(struct sockaddr_un, sun_path) + len)) < 0)
     {
-        /*------------------------------------------------------------------------------------------------------------*/
+        close(fd);
 
-        n = fread(chunk, 1, sizeof(chunk), fp);
+        return -1;
+    }
 
-        if(n > 0)
-        {
-            /*--------------------------------------------------------------------------------------------------------*/
+    /*----------------------------------------------------------------------------------------------------------------*/
 
-            for(size_t i = 0; i < n; i++)
-            {
-                if(chunk[i] == '\0')
-                {
-                    chunk[i] = ' ';
-                }
-            }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
 
-            /*--------------------------------------------------------------------------------------------------------*/
+    /*----------------------------------------------------------------------------------------------------------------*/
 
-            nyx_string_builder_append_buff(sb, NYX_SB_NO_ESCAPE, n, chunk);
+    return fd;
+}
 
-            /*--------------------------------------------------------------------------------------------------------*/
-        }
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool probe_unix_socket(STR_t path)
+{
+    int fd = nyx_unix_connect(path);
 
-        /*------------------------------------------------------------------------------------------------------------*/
+    if(fd >= 0)
+    {
+        close(fd);
+
+        return true;
+    }
+
+    return false;
+}
 
-    } while(n == sizeof(chunk));
+/*--------------------------------------------------------------------------------------------------------------------*/
 
+static size_t read_cmdline(str_t buff, size_t size)
+{
     /*----------------------------------------------------------------------------------------------------------------*/
 
-    fclose(fp);
+    char path[64];
+
+    snprintf(path, sizeof(path), "/proc/%d/cmdline", getppid());
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if(fd < 0)
+    {
+        return 0;
+    }
 
     /*----------------------------------------------------------------------------------------------------------------*/
 
-    str_t result = nyx_string_builder_to_string(sb);
-    nyx_string_builder_free(sb);
-    return result;
+    ssize_t n = read(fd, buff, size - 1);
+
+    close(fd);
 
     /*----------------------------------------------------------------------------------------------------------------*/
-}
 
-/*--------------------------------------------------------------------------------------------------------------------*/
+    if(n <= 0)
+    {
+        return 0;
+    }
 
-static char indiserver_url[64];
+    buff[n] = '\0';
 
-#define DEFAULT_INDI_PORT 7624
+    return (size_t) n;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
 STR_t nyx_discover_indi_url(void)
 {
-    char buff[64];
-
     /*----------------------------------------------------------------------------------------------------------------*/
-    /* DISCOVER INDISERVER PORT                                                                                       */
+    /* EXPLICIT CONFIGURATION                                                                                         */
     /*----------------------------------------------------------------------------------------------------------------*/
 
-    int port = DEFAULT_INDI_PORT;
-
-    /*----------------------------------------------------------------------------------------------------------------*/
+    STR_t env_socket = getenv("NYX_INDI_SOCKET");
 
-    snprintf(buff, sizeof(buff), "/proc/%d/cmdline", getppid());
+    if(env_socket != NULL && env_socket[0] != '\0')
+    {
+        snprintf(indiserver_url, sizeof(indiserver_url), "unix://%s", env_socket);
 
-    str_t content = read_entire_file(buff);
+        return indiserver_url;
+    }
 
-    /*----------------------------------------------------------------------------------------------------------------*/
+    STR_t env_port = getenv("NYX_INDI_PORT");
 
-    if(content != NULL)
+    if(env_port != NULL && env_port[0] != '\0')
     {
-        /*------------------------------------------------------------------------------------------------------------*/
+        snprintf(indiserver_url, sizeof(indiserver_url), "tcp://localhost:%d", (int) strtol(env_port, NULL, 10));
 
-        regex_t re;
+        return indiserver_url;
+    }
 
-        if(regcomp(&re, "-p[[:space:]]*([0-9]+)", REG_EXTENDED) == 0)
-        {
-            /*--------------------------------------------------------------------------------------------------------*/
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* DISCOVER INDISERVER PORT AND SOCKET FROM THE PARENT COMMAND LINE                                               */
+    /*----------------------------------------------------------------------------------------------------------------*/
 
-            regmatch_t m[2];
+    int port = DEFAULT_INDI_PORT;
 
-            if(regexec(&re, content, 2, m, 0) == 0 && m[1].rm_so >= 0)
-            {
-                /*----------------------------------------------------------------------------------------------------*/
+    STR_t socket_path = DEFAULT_INDI_SOCKET;
 
-                size_t size = (size_t) m[1].rm_eo
-                              -
-                              (size_t) m[1].rm_so
-                ;
+    /*----------------------------------------------------------------------------------------------------------------*/
 
-                if(size > sizeof(buff) - 1)
-                {
-                    size = sizeof(buff) - 1;
-                }
+    char cmdline[4096];
 
-                strncpy(buff, content + m[1].rm_so, size)[size] = '\0';
+    STR_t end = cmdline + read_cmdline(cmdline, sizeof(cmdline));
 
-                /*----------------------------------------------------------------------------------------------------*/
+    for(STR_t arg = cmdline; arg < end; arg += strlen(arg) + 1)
+    {
+        STR_t next = arg + strlen(arg) + 1;
 
-                port = (int) strtol(buff, NULL, 10);
+        /**/ if(strncmp(arg, "-p", 2) == 0)
+        {
+            STR_t value = arg[2] != '\0' ? arg + 2 : (next < end ? next : "");
 
-                /*----------------------------------------------------------------------------------------------------*/
+            if(value[0] >= '0' && value[0] <= '9')
+            {
+                port = (int) strtol(value, NULL, 10);
             }
-
-            /*--------------------------------------------------------------------------------------------------------*/
-
-            /*--*/regfree/*--*/(&re);
-
-            /*--------------------------------------------------------------------------------------------------------*/
         }
+        else if(strncmp(arg, "-u", 2) == 0)
+        {
+            STR_t value = arg[2] != '\0' ? arg + 2 : (next < end ? next : "");
 
-        /*------------------------------------------------------------------------------------------------------------*/
-
-        nyx_memory_free(content);
-
-        /*------------------------------------------------------------------------------------------------------------*/
+            if(value[0] != '\0' && value[0] != '-')
+            {
+                socket_path = value;
+            }
+        }
     }
 
     /*----------------------------------------------------------------------------------------------------------------*/
-    /* BUILD INDISERVER ADDRESS                                                                                       */
+    /* BUILD INDISERVER ADDRESS, PREFERRING THE UNIX SOCKET (ABSTRACT FIRST, AS INDISERVER DOES ON LINUX)             */
     /*----------------------------------------------------------------------------------------------------------------*/
 
-    snprintf(indiserver_url, sizeof(indiserver_url), "tcp://localhost:%d", port);
+    char abstract_path[108];
+
+    snprintf(abstract_path, sizeof(abstract_path), "@%s", socket_path);
+
+    /**/ if(probe_unix_socket(abstract_path))
+    {
+        snprintf(indiserver_url, sizeof(indiserver_url), "unix://%s", abstract_path);
+    }
+    else if(probe_unix_socket(socket_path))
+    {
+        snprintf(indiserver_url, sizeof(indiserver_url), "unix://%s", socket_path);
+    }
+    else
+    {
+        snprintf(indiserver_url, sizeof(indiserver_url), "tcp://localhost:%d", port);
+    }
 
     /*----------------------------------------------------------------------------------------------------------------*/
 
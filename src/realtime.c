@@ -0,0 +1,194 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <errno.h>
+#include <malloc.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include "bridge.h"
+
+#include "external/mongoose.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define STACK_RESERVE (512 * 1024)
+
+#define HEAP_CHUNK_SIZE (64 * 1024)
+
+#define HEAP_MMAP_THRESHOLD_MAX (4 * 1024 * 1024 * sizeof(long))
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void prefault_stack(void)
+{
+    volatile char stack[STACK_RESERVE];
+
+    for(size_t i = 0; i < STACK_RESERVE; i += 4096)
+    {
+        stack[i] = 0;
+    }
+
+    (void) stack[0];
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool prefault_heap(size_t size)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* FREED MEMORY MUST STAY IN THE ARENA AND BLOCKS UP TO THE RESERVE ARE SERVED FROM IT, LARGER ONES (BIG BLOBS)   */
+    /* STILL GET THEIR OWN MAPPING, LOCKED BY MCL_FUTURE, INSTEAD OF FAILING ONCE THE ARENA CANNOT GROW ANY MORE      */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    size_t threshold = size < HEAP_MMAP_THRESHOLD_MAX ? size : HEAP_MMAP_THRESHOLD_MAX;
+
+    if(mallopt(M_TRIM_THRESHOLD, -1) == 0)
+    {
+        return false;
+    }
+
+    if(threshold > HEAP_CHUNK_SIZE && mallopt(M_MMAP_THRESHOLD, (int) threshold) == 0)
+    {
+        return false;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* TOUCH THE RESERVE IN SMALL CHUNKS, WHICH ARE THEN RELEASED TO THE ALLOCATOR WITHOUT BEING UNMAPPED             */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    size_t n = size / HEAP_CHUNK_SIZE;
+
+    if(n == 0)
+    {
+        return true;
+    }
+
+    buff_t *chunks = calloc(n, sizeof(buff_t));
+
+    if(chunks == NULL)
+    {
+        return false;
+    }
+
+    for(size_t i = 0; i < n; i++)
+    {
+        if((chunks[i] = malloc(HEAP_CHUNK_SIZE)) != NULL)
+        {
+            memset(chunks[i], 0x00, HEAP_CHUNK_SIZE);
+        }
+    }
+
+    for(size_t i = 0; i < n; i++)
+    {
+        free(chunks[i]);
+    }
+
+    free(chunks);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool nyx_realtime_setup(int cpu, int priority, size_t heap_reserve)
+{
+    bool result = true;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* MEMORY                                                                                                         */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        MG_ERROR(("Cannot lock memory: %s", strerror(errno)));
+
+        result = false;
+    }
+
+    if(prefault_heap(heap_reserve) == false)
+    {
+        MG_ERROR(("Cannot reserve %lu bytes of heap", (unsigned long) heap_reserve));
+
+        result = false;
+    }
+
+    prefault_stack();
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* CPU AFFINITY                                                                                                   */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(cpu >= 0)
+    {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+
+        CPU_SET(cpu, &set);
+
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+        if(err != 0)
+        {
+            MG_ERROR(("Cannot pin the bridge thread to CPU %d: %s", cpu, strerror(err)));
+
+            result = false;
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* SCHEDULING                                                                                                     */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(priority > 0)
+    {
+        struct sched_param param = {
+            .sched_priority = priority,
+        };
+
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+        if(err != 0)
+        {
+            MG_ERROR(("Cannot set SCHED_FIFO priority %d (needs CAP_SYS_NICE or an rtprio limit): %s", priority, strerror(err)));
+
+            result = false;
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return result;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_realtime_get_stats(nyx_realtime_stats_t *result)
+{
+    struct rusage usage;
+
+    if(getrusage(RUSAGE_THREAD, &usage) == 0)
+    {
+        result->minor_faults = (uint64_t) usage.ru_minflt;
+        result->major_faults = (uint64_t) usage.ru_majflt;
+        result->voluntary_switches = (uint64_t) usage.ru_nvcsw;
+        result->involuntary_switches = (uint64_t) usage.ru_nivcsw;
+    }
+    else
+    {
+        memset(result, 0x00, sizeof(nyx_realtime_stats_t));
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,484 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "external/mongoose.h"
+
+#include "bridge.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define SPOOL_MAGIC "NYXSPL01"
+
+#define HEADER_SIZE 4096
+
+#define ALIGN(n) (((n) + 7) & ~(size_t) 7)
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* FILE = HEADER PAGE, RING OF RECORDS (head AND tail ARE ABSOLUTE POSITIONS, THE RING OFFSET IS pos % capacity)      */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    char magic[8];
+
+    uint64_t capacity;
+
+    uint64_t head;
+    uint64_t tail;
+
+    uint64_t count;
+
+} header_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* RECORD = HEADER, tag\0 device\0 name\0 state\0 json\0, 8-BYTE ALIGNED (size == 0: SKIP TO THE END OF THE RING)     */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    uint32_t size;
+
+    uint32_t json_len;
+
+    uint16_t meta_len[4];
+
+} record_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static int m_fd = -1;
+
+static size_t m_map_size = 0;
+
+static header_t *m_header = NULL;
+
+static uint8_t *m_ring = NULL;
+
+static nyx_spool_stats_t m_stats = {0};
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void spool_reset(uint64_t capacity)
+{
+    memset(m_header, 0x00, sizeof(header_t));
+
+    memcpy(m_header->magic, SPOOL_MAGIC, sizeof(m_header->magic));
+
+    m_header->capacity = capacity;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool spool_valid(uint64_t capacity)
+{
+    return memcmp(m_header->magic, SPOOL_MAGIC, sizeof(m_header->magic)) == 0
+           &&
+           m_header->capacity == capacity
+           &&
+           m_header->head <= m_header->tail
+           &&
+           m_header->tail - m_header->head <= capacity
+    ;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool record_fits(const record_t *record)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* THE LENGTHS COME FROM THE FILE, THEY MUST NOT LEAD OUTSIDE THE RECORD                                          */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint64_t size = sizeof(record_t) + (uint64_t) record->json_len + 1;
+
+    for(int i = 0; i < 4; i++)
+    {
+        size += (uint64_t) record->meta_len[i] + 1;
+    }
+
+    if(size > record->size)
+    {
+        return false;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* NOR TO A FIELD THAT IS NOT TERMINATED                                                                          */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    STR_t p = (STR_t) (record + 1);
+
+    for(int i = 0; i < 4; i++)
+    {
+        p += record->meta_len[i];
+
+        if(*p++ != '\0')
+        {
+            return false;
+        }
+    }
+
+    return p[record->json_len] == '\0';
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static size_t spool_next(bool *padding)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* SIZE OF WHAT IS AT THE HEAD (A RECORD OR THE PADDING BEFORE THE END OF THE RING), 0 IF THE RING IS CORRUPTED   */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint64_t offset = m_header->head % m_header->capacity;
+
+    uint64_t remaining = m_header->capacity - offset;
+
+    const record_t *record = (const record_t *) (m_ring + offset);
+
+    /**/ if(remaining < sizeof(record_t) || record->size == 0)
+    {
+        *padding = true;
+
+        return (size_t) remaining;
+    }
+    else if(record->size < sizeof(record_t) || record->size > remaining || record->size > m_header->tail - m_header->head || record_fits(record) == false)
+    {
+        MG_ERROR(("Corrupted spool, %lu messages lost", (unsigned long) m_header->count));
+
+        spool_reset(m_header->capacity);
+
+        return 0;
+    }
+
+    *padding = false;
+
+    return record->size;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool nyx_spool_open(STR_t path, size_t capacity)
+{
+    capacity = ALIGN(capacity);
+
+    if(capacity < HEADER_SIZE)
+    {
+        return false;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    m_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+    if(m_fd < 0)
+    {
+        MG_ERROR(("Cannot open spool `%s`: %s", path, strerror(errno)));
+
+        return false;
+    }
+
+    m_map_size = HEADER_SIZE + capacity;
+
+    if(ftruncate(m_fd, (off_t) m_map_size) != 0)
+    {
+        MG_ERROR(("Cannot size spool `%s`: %s", path, strerror(errno)));
+
+        close(m_fd);
+
+        m_fd = -1;
+
+        return false;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    void *map = mmap(NULL, m_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+
+    if(map == MAP_FAILED)
+    {
+        MG_ERROR(("Cannot map spool `%s`: %s", path, strerror(errno)));
+
+        close(m_fd);
+
+        m_fd = -1;
+
+        return false;
+    }
+
+    m_header = (header_t *) map;
+
+    m_ring = (uint8_t *) map + HEADER_SIZE;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* MESSAGES LEFT BY A PREVIOUS RUN ARE KEPT, A SPOOL OF ANOTHER SIZE OR FORMAT IS RESET                           */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(spool_valid(capacity))
+    {
+        MG_INFO(("Spool `%s` holds %lu messages", path, (unsigned long) m_header->count));
+    }
+    else
+    {
+        spool_reset(capacity);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_spool_close(void)
+{
+    if(m_header != NULL)
+    {
+        msync(m_header, m_map_size, MS_SYNC);
+
+        munmap(m_header, m_map_size);
+
+        m_header = NULL;
+
+        m_ring = NULL;
+    }
+
+    if(m_fd >= 0)
+    {
+        close(m_fd);
+
+        m_fd = -1;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_spool_sync(void)
+{
+    if(m_header != NULL)
+    {
+        msync(m_header, m_map_size, MS_ASYNC);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool nyx_spool_empty(void)
+{
+    return m_header == NULL || m_header->head == m_header->tail;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_spool_append(const nyx_meta_t *meta, size_t len, STR_t json)
+{
+    if(m_header == NULL)
+    {
+        return;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    STR_t fields[4] = {meta->tag, meta->device, meta->name, meta->state};
+
+    size_t field_lens[4];
+
+    size_t size = sizeof(record_t) + len + 1;
+
+    for(int i = 0; i < 4; i++)
+    {
+        field_lens[i] = fields[i] != NULL ? strnlen(fields[i], 0xFFFF) : 0;
+
+        size += field_lens[i] + 1;
+    }
+
+    size = ALIGN(size);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* A MESSAGE LARGER THAN A QUARTER OF THE RING WOULD EVICT MOST OF IT                                             */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(size > m_header->capacity / 4)
+    {
+        m_stats.rejected++;
+
+        return;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* MAKE ROOM, OLDEST FIRST                                                                                        */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint64_t offset = m_header->tail % m_header->capacity;
+
+    uint64_t padding = m_header->capacity - offset < size ? m_header->capacity - offset : 0;
+
+    while(m_header->capacity - (m_header->tail - m_header->head) < padding + size)
+    {
+        bool skipped;
+
+        size_t skip = spool_next(&skipped);
+
+        if(skip == 0)
+        {
+            offset = 0;
+
+            padding = 0;
+
+            continue;
+        }
+
+        m_header->head += skip;
+
+        if(skipped == false)
+        {
+            m_header->count--;
+
+            m_stats.evicted++;
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(padding > 0)
+    {
+        if(padding >= sizeof(record_t))
+        {
+            memset(m_ring + offset, 0x00, sizeof(record_t));
+        }
+
+        m_header->tail += padding;
+
+        offset = 0;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    record_t *record = (record_t *) (m_ring + offset);
+
+    uint8_t *p = (uint8_t *) (record + 1);
+
+    for(int i = 0; i < 4; i++)
+    {
+        record->meta_len[i] = (uint16_t) field_lens[i];
+
+        memcpy(p, fields[i] != NULL ? fields[i] : "", field_lens[i]);
+
+        p += field_lens[i];
+
+        *p++ = '\0';
+    }
+
+    record->json_len = (uint32_t) len;
+
+    memcpy(p, json, len);
+
+    p[len] = '\0';
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* THE RECORD IS COMPLETE BEFORE IT BECOMES VISIBLE                                                               */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    record->size = (uint32_t) size;
+
+    m_header->tail += size;
+
+    m_header->count++;
+
+    m_stats.spooled++;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+size_t nyx_spool_replay(size_t budget, nyx_spool_visit_fn visit_fn)
+{
+    size_t result = 0;
+
+    while(m_header != NULL && m_header->head != m_header->tail && result < budget)
+    {
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        bool padding;
+
+        size_t size = spool_next(&padding);
+
+        if(size == 0)
+        {
+            break;
+        }
+
+        if(padding)
+        {
+            m_header->head += size;
+
+            continue;
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        const record_t *record = (const record_t *) (m_ring + m_header->head % m_header->capacity);
+
+        STR_t p = (STR_t) (record + 1);
+
+        STR_t fields[4];
+
+        for(int i = 0; i < 4; i++)
+        {
+            fields[i] = record->meta_len[i] > 0 ? p : NULL;
+
+            p += record->meta_len[i] + 1;
+        }
+
+        const nyx_meta_t meta = {
+            .tag = fields[0],
+            .device = fields[1],
+            .name = fields[2],
+            .state = fields[3],
+        };
+
+        if(meta.tag != NULL)
+        {
+            visit_fn(&meta, record->json_len, p);
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        m_header->head += size;
+
+        m_header->count--;
+
+        m_stats.replayed++;
+
+        result += size;
+
+        /*------------------------------------------------------------------------------------------------------------*/
+    }
+
+    return result;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_spool_get_stats(nyx_spool_stats_t *result)
+{
+    memcpy(result, &m_stats, sizeof(nyx_spool_stats_t));
+
+    if(m_header != NULL)
+    {
+        result->messages = m_header->count;
+
+        result->bytes = m_header->tail - m_header->head;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
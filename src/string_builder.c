@@ -79,14 +79,12 @@ void nyx_string_builder_clear(nyx_string_builder_t *sb)
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-void nyx_string_builder_append_buff(nyx_string_builder_t *sb, uint32_t flags, size_t len, STR_t str)
+str_t nyx_string_builder_reserve(nyx_string_builder_t *sb, uint32_t flags, size_t len)
 {
     /*----------------------------------------------------------------------------------------------------------------*/
 
     node_t *node = nyx_memory_alloc(sizeof(node_t) + len + 1);
 
-    memcpy((str_t) (node + 1), str, len);
-
     /*----------------------------------------------------------------------------------------------------------------*/
 
     node->len = len;
@@ -107,6 +105,15 @@ void nyx_string_builder_append_buff(nyx_string_builder_t *sb, uint32_t flags, si
     }
 
     /*----------------------------------------------------------------------------------------------------------------*/
+
+    return (str_t) (node + 1);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_string_builder_append_buff(nyx_string_builder_t *sb, uint32_t flags, size_t len, STR_t str)
+{
+    memcpy(nyx_string_builder_reserve(sb, flags, len), str, len);
 }
 
 /*--------------------------------------------------------------------------------------------------------------------*/
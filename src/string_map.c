@@ -0,0 +1,275 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "bridge.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define INITIAL_CAPACITY 16
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct nyx_string_map_node_s
+{
+    uint32_t hash;
+
+    buff_t value;
+
+    struct nyx_string_map_node_s *next;
+
+} node_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+struct nyx_string_map_s
+{
+    size_t size;
+
+    size_t capacity;
+
+    node_t **buckets;
+};
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static uint32_t hash_of(STR_t key)
+{
+    uint32_t result = 2166136261U;
+
+    while(*key != '\0')
+    {
+        result ^= (uint8_t) *key++;
+
+        result *= 16777619U;
+    }
+
+    return result;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static STR_t key_of(const node_t *node)
+{
+    return (STR_t) (node + 1);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void grow(nyx_string_map_t *map)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    size_t capacity = 2 * map->capacity;
+
+    node_t **buckets = nyx_memory_alloc(capacity * sizeof(node_t *));
+
+    memset(buckets, 0x00, capacity * sizeof(node_t *));
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    for(size_t i = 0; i < map->capacity; i++)
+    {
+        for(node_t *node = map->buckets[i]; node != NULL;)
+        {
+            node_t *temp = node;
+
+            node = node->next;
+
+            temp->next = buckets[temp->hash & (capacity - 1)];
+
+            buckets[temp->hash & (capacity - 1)] = temp;
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_memory_free(map->buckets);
+
+    map->capacity = capacity;
+
+    map->buckets = buckets;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+nyx_string_map_t *nyx_string_map_new(void)
+{
+    nyx_string_map_t *map = nyx_memory_alloc(sizeof(nyx_string_map_t));
+
+    map->size = 0;
+
+    map->capacity = INITIAL_CAPACITY;
+
+    map->buckets = nyx_memory_alloc(INITIAL_CAPACITY * sizeof(node_t *));
+
+    memset(map->buckets, 0x00, INITIAL_CAPACITY * sizeof(node_t *));
+
+    return map;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_string_map_free(nyx_string_map_t *map)
+{
+    nyx_string_map_clear(map);
+
+    nyx_memory_free(map->buckets);
+
+    nyx_memory_free(map);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_string_map_clear(nyx_string_map_t *map)
+{
+    for(size_t i = 0; i < map->capacity; i++)
+    {
+        for(node_t *node = map->buckets[i]; node != NULL;)
+        {
+            node_t *temp = node;
+
+            node = node->next;
+
+            nyx_memory_free(temp);
+        }
+
+        map->buckets[i] = NULL;
+    }
+
+    map->size = 0;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+size_t nyx_string_map_size(const nyx_string_map_t *map)
+{
+    return map->size;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+buff_t nyx_string_map_get(const nyx_string_map_t *map, STR_t key)
+{
+    uint32_t hash = hash_of(key);
+
+    for(node_t *node = map->buckets[hash & (map->capacity - 1)]; node != NULL; node = node->next)
+    {
+        if(node->hash == hash && strcmp(key_of(node), key) == 0)
+        {
+            return node->value;
+        }
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+buff_t nyx_string_map_put(nyx_string_map_t *map, STR_t key, buff_t value)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint32_t hash = hash_of(key);
+
+    for(node_t *node = map->buckets[hash & (map->capacity - 1)]; node != NULL; node = node->next)
+    {
+        if(node->hash == hash && strcmp(key_of(node), key) == 0)
+        {
+            buff_t result = node->value;
+
+            node->value = value;
+
+            return result;
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(map->size >= map->capacity)
+    {
+        grow(map);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    size_t len = strlen(key);
+
+    node_t *node = nyx_memory_alloc(sizeof(node_t) + len + 1);
+
+    memcpy((str_t) (node + 1), key, len + 1);
+
+    node->hash = hash;
+    node->value = value;
+    node->next = map->buckets[hash & (map->capacity - 1)];
+
+    map->buckets[hash & (map->capacity - 1)] = node;
+
+    map->size++;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+buff_t nyx_string_map_del(nyx_string_map_t *map, STR_t key)
+{
+    uint32_t hash = hash_of(key);
+
+    for(node_t **link = &map->buckets[hash & (map->capacity - 1)]; *link != NULL; link = &(*link)->next)
+    {
+        node_t *node = *link;
+
+        if(node->hash == hash && strcmp(key_of(node), key) == 0)
+        {
+            buff_t result = node->value;
+
+            *link = node->next;
+
+            nyx_memory_free(node);
+
+            map->size--;
+
+            return result;
+        }
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_string_map_foreach(nyx_string_map_t *map, nyx_string_map_visit_fn visit_fn, buff_t arg)
+{
+    for(size_t i = 0; i < map->capacity; i++)
+    {
+        for(node_t **link = &map->buckets[i]; *link != NULL;)
+        {
+            node_t *node = *link;
+
+            if(visit_fn(key_of(node), node->value, arg))
+            {
+                *link = node->next;
+
+                nyx_memory_free(node);
+
+                map->size--;
+            }
+            else
+            {
+                link = &node->next;
+            }
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
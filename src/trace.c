@@ -0,0 +1,189 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "bridge.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define MAX_THREADS 8
+
+#define RING_SIZE 65536 /* POWER OF TWO */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    uint64_t ts;
+
+    STR_t name;
+
+    char phase;
+
+} event_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    int tid;
+
+    uint64_t head;
+
+    event_t events[RING_SIZE];
+
+} ring_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* ONE RING PER THREAD, WRITTEN BY ITS OWNER ONLY: RECORDING NEEDS NO LOCK, ONLY A RELEASE STORE OF THE HEAD          */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static ring_t *m_rings[MAX_THREADS] = {NULL};
+
+static size_t m_ring_cnt = 0;
+
+static __thread ring_t *m_ring = NULL;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static ring_t *register_thread(void)
+{
+    size_t idx = __atomic_fetch_add(&m_ring_cnt, 1, __ATOMIC_ACQ_REL);
+
+    if(idx >= MAX_THREADS)
+    {
+        return NULL;
+    }
+
+    ring_t *ring = nyx_memory_alloc(sizeof(ring_t));
+
+    ring->tid = (int) syscall(SYS_gettid);
+
+    ring->head = 0;
+
+    __atomic_store_n(&m_rings[idx], ring, __ATOMIC_RELEASE);
+
+    return ring;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_trace_event(STR_t name, char phase)
+{
+    ring_t *ring = m_ring;
+
+    if(ring == NULL && (ring = m_ring = register_thread()) == NULL)
+    {
+        return;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint64_t head = ring->head;
+
+    event_t *event = &ring->events[head & (RING_SIZE - 1)];
+
+    event->ts = (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+    event->name = name;
+    event->phase = phase;
+
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+str_t nyx_trace_dump(void)
+{
+    nyx_string_builder_t *sb = nyx_string_builder_from(NYX_SB_NO_ESCAPE, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    char buff[256];
+
+    bool first = true;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    size_t ring_cnt = __atomic_load_n(&m_ring_cnt, __ATOMIC_ACQUIRE);
+
+    for(size_t i = 0; i < ring_cnt && i < MAX_THREADS; i++)
+    {
+        const ring_t *ring = __atomic_load_n(&m_rings[i], __ATOMIC_ACQUIRE);
+
+        if(ring == NULL)
+        {
+            continue;
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+        uint64_t tail = head > RING_SIZE ? head - RING_SIZE : 0;
+
+        for(uint64_t j = tail; j < head; j++)
+        {
+            const event_t *event = &ring->events[j & (RING_SIZE - 1)];
+
+            snprintf(buff, sizeof(buff), "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu.%03llu,\"pid\":%d,\"tid\":%d%s}",
+                first ? "" : ",",
+                event->name,
+                event->phase,
+                (unsigned long long) (event->ts / 1000ULL),
+                (unsigned long long) (event->ts % 1000ULL),
+                (int) getpid(),
+                ring->tid,
+                event->phase == 'i' ? ",\"s\":\"t\"" : ""
+            );
+
+            nyx_string_builder_append(sb, NYX_SB_NO_ESCAPE, buff);
+
+            first = false;
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_string_builder_append(sb, NYX_SB_NO_ESCAPE, "]}");
+
+    str_t result = nyx_string_builder_to_string(sb);
+
+    nyx_string_builder_free(sb);
+
+    return result;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+bool nyx_trace_dump_to_file(STR_t path)
+{
+    str_t json = nyx_trace_dump();
+
+    FILE *fp = fopen(path, "w");
+
+    if(fp != NULL)
+    {
+        fputs(json, fp);
+
+        fclose(fp);
+    }
+
+    nyx_memory_free(json);
+
+    return fp != NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
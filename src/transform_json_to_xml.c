@@ -13,9 +13,15 @@
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+#define STREAM_BUFF_SIZE 512
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
 struct nyx_j2x_ctx_s
 {
     nyx_j2x_emit_fn emit_fn;
+
+    size_t stream_threshold;
 };
 
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -50,56 +56,310 @@ static bool key_is_attr(struct mg_str str)
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-static str_t dup_json_string(struct mg_str str)
+static bool parse_hex4(STR_t s, uint32_t *result)
+{
+    *result = 0;
+
+    for(int i = 0; i < 4; i++)
+    {
+        char c = s[i];
+
+        /**/ if(c >= '0' && c <= '9') *result = (*result << 4) | (uint32_t) (c - '0');
+        else if(c >= 'a' && c <= 'f') *result = (*result << 4) | (uint32_t) (c - 'a' + 10);
+        else if(c >= 'A' && c <= 'F') *result = (*result << 4) | (uint32_t) (c - 'A' + 10);
+        else return false;
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* ONE JSON ESCAPE SEQUENCE (s[0] == '\\') -> UP TO 4 UTF-8 BYTES, A MALFORMED ONE BECOMES '?' AND NUL IS DROPPED     */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static size_t unescape_json_char(STR_t s, STR_t end, char result[4], size_t *consumed)
 {
-    str_t result;
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    *consumed = s + 1 < end ? 2 : 1;
+
+    result[0] = '?';
+
+    if(s + 1 >= end)
+    {
+        return 1;
+    }
 
     /*----------------------------------------------------------------------------------------------------------------*/
 
+    if(s[1] != 'u')
+    {
+        switch(s[1])
+        {
+            case '"': result[0] = '"'; break;
+            case '\\': result[0] = '\\'; break;
+            case '/': result[0] = '/'; break;
+            case 'b': result[0] = '\b'; break;
+            case 'f': result[0] = '\f'; break;
+            case 'n': result[0] = '\n'; break;
+            case 'r': result[0] = '\r'; break;
+            case 't': result[0] = '\t'; break;
+        }
+
+        return 1;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* \uXXXX, OR A \uD8XX\uDCXX SURROGATE PAIR                                                                       */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint32_t cp, lo;
+
+    if(s + 6 > end || parse_hex4(s + 2, &cp) == false)
+    {
+        return 1;
+    }
+
+    *consumed = 6;
+
+    if(cp >= 0xD800 && cp <= 0xDFFF)
+    {
+        if(cp <= 0xDBFF && s + 12 <= end && s[6] == '\\' && s[7] == 'u' && parse_hex4(s + 8, &lo) && lo >= 0xDC00 && lo <= 0xDFFF)
+        {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+
+            *consumed = 12;
+        }
+        else
+        {
+            return 1;
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    /**/ if(cp == 0x0000)
+    {
+        return 0;
+    }
+    else if(cp < 0x0080)
+    {
+        result[0] = (char) cp;
+
+        return 1;
+    }
+    else if(cp < 0x0800)
+    {
+        result[0] = (char) (0xC0 | (cp >> 6));
+        result[1] = (char) (0x80 | (cp & 0x3F));
+
+        return 2;
+    }
+    else if(cp < 0x10000)
+    {
+        result[0] = (char) (0xE0 | (cp >> 12));
+        result[1] = (char) (0x80 | ((cp >> 6) & 0x3F));
+        result[2] = (char) (0x80 | (cp & 0x3F));
+
+        return 3;
+    }
+    else
+    {
+        result[0] = (char) (0xF0 | (cp >> 18));
+        result[1] = (char) (0x80 | ((cp >> 12) & 0x3F));
+        result[2] = (char) (0x80 | ((cp >> 6) & 0x3F));
+        result[3] = (char) (0x80 | (cp & 0x3F));
+
+        return 4;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static str_t dup_json_string(struct mg_str str)
+{
     STR_t s = str.buf;
     size_t n = str.len;
 
-    if(n >= 2
-       &&
-       s[0x000] == '"'
-       &&
-       s[n - 1] == '"'
-    ) {
-        /*------------------------------------------------------------------------------------------------------------*/
+    if(n < 2 || s[0] != '"' || s[n - 1] != '"')
+    {
+        return nyx_string_ndup(s, n);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* AN ESCAPE SEQUENCE IS NEVER SHORTER THAN ITS UTF-8 ENCODING                                                    */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    STR_t end = s + n - 1;
 
-        struct mg_str inner = mg_str_n(
-            s + 1,
-            n - 2
-        );
+    str_t result = nyx_memory_alloc(n);
 
-        result = nyx_memory_alloc(inner.len + 1);
+    size_t len = 0;
 
-        if(mg_json_unescape(inner, result, inner.len + 1) == false)
+    for(s++; s < end;)
+    {
+        if(*s == '\\')
         {
-            memcpy(result, inner.buf, inner.len);
+            size_t consumed;
+
+            len += unescape_json_char(s, end, result + len, &consumed);
 
-            result[inner.len] = '\0';
+            s += consumed;
+        }
+        else
+        {
+            result[len++] = *s++;
         }
+    }
 
-        /*------------------------------------------------------------------------------------------------------------*/
+    result[len] = '\0';
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return result;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void flush_builder(const nyx_j2x_ctx_t *ctx, const nyx_meta_t *meta, nyx_string_builder_t *sb)
+{
+    str_t xml = nyx_string_builder_to_string(sb);
+    ctx->emit_fn(strlen(xml), xml, meta);
+    nyx_memory_free(xml);
+
+    nyx_string_builder_clear(sb);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static STR_t xml_entity(char c)
+{
+    switch(c)
+    {
+        case '<': return "&lt;";
+        case '>': return "&gt;";
+        case '&': return "&amp;";
+        case '\"': return "&quot;";
+        case '\'': return "&apos;";
+        default: return NULL;
     }
-    else
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void stream_json_string(const nyx_j2x_ctx_t *ctx, const nyx_meta_t *meta, struct mg_str str)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+    /* UNESCAPE JSON / ESCAPE XML WITHOUT COPYING THE WHOLE STRING: PLAIN RUNS (E.G. BASE64) ARE EMITTED IN PLACE,    */
+    /* SHORT RUNS AND ESCAPED CHARACTERS ARE BATCHED IN A SMALL BUFFER                                                */
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    char buff[STREAM_BUFF_SIZE];
+
+    size_t buff_len = 0;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    STR_t s = str.buf + 1;
+    STR_t end = str.buf + str.len - 1;
+
+    while(s < end)
     {
         /*------------------------------------------------------------------------------------------------------------*/
 
-        result = nyx_string_ndup(s, n);
+        STR_t run = s;
+
+        while(s < end && *s != '\\' && xml_entity(*s) == NULL)
+        {
+            s++;
+        }
+
+        size_t run_len = (size_t) (s - run);
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        if(buff_len + run_len + 8 > sizeof(buff))
+        {
+            if(buff_len > 0)
+            {
+                ctx->emit_fn(buff_len, buff, meta);
+
+                buff_len = 0;
+            }
+
+            if(run_len + 8 > sizeof(buff))
+            {
+                ctx->emit_fn(run_len, run, meta);
+
+                run_len = 0;
+            }
+        }
+
+        memcpy(buff + buff_len, run, run_len);
+
+        buff_len += run_len;
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        if(s < end)
+        {
+            char c[4] = {*s};
+
+            size_t c_len = 1;
+
+            if(c[0] == '\\')
+            {
+                size_t consumed;
+
+                c_len = unescape_json_char(s, end, c, &consumed);
+
+                s += consumed;
+            }
+            else
+            {
+                s++;
+            }
+
+            /*--------------------------------------------------------------------------------------------------------*/
+
+            for(size_t i = 0; i < c_len; i++)
+            {
+                STR_t entity = xml_entity(c[i]);
+
+                if(entity != NULL)
+                {
+                    size_t entity_len = strlen(entity);
+
+                    memcpy(buff + buff_len, entity, entity_len);
+
+                    buff_len += entity_len;
+                }
+                else
+                {
+                    buff[buff_len++] = c[i];
+                }
+            }
+        }
 
         /*------------------------------------------------------------------------------------------------------------*/
     }
 
     /*----------------------------------------------------------------------------------------------------------------*/
 
-    return result;
+    if(buff_len > 0)
+    {
+        ctx->emit_fn(buff_len, buff, meta);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
 }
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-static void j2x_emit_element(nyx_string_builder_t *out, struct mg_str obj)
+static void j2x_emit_element(const nyx_j2x_ctx_t *ctx, const nyx_meta_t *meta, nyx_string_builder_t *sb,
+                             struct mg_str obj)
 {
     struct mg_str k;
     struct mg_str v;
@@ -132,7 +392,7 @@ static void j2x_emit_element(nyx_string_builder_t *out, struct mg_str obj)
 
     /*----------------------------------------------------------------------------------------------------------------*/
 
-    nyx_string_builder_append(out, NYX_SB_NO_ESCAPE, "<", tag);
+    nyx_string_builder_append(sb, NYX_SB_NO_ESCAPE, "<", tag);
 
     for(size_t offset = 0; (offset = mg_json_next(obj, offset, &k, &v)) != 0; )
     {
@@ -140,11 +400,11 @@ static void j2x_emit_element(nyx_string_builder_t *out, struct mg_str obj)
         {
             str_t val = dup_json_string(v);
 
-            nyx_string_builder_append(out, NYX_SB_NO_ESCAPE, " ");
-            nyx_string_builder_append_buff(out, NYX_SB_NO_ESCAPE, k.len - 3, k.buf + 2);
-            nyx_string_builder_append(out, NYX_SB_NO_ESCAPE, "=\"");
-            nyx_string_builder_append(out, NYX_SB_ESCAPE_XML, val);
-            nyx_string_builder_append(out, NYX_SB_NO_ESCAPE, "\"");
+            nyx_string_builder_append(sb, NYX_SB_NO_ESCAPE, " ");
+            nyx_string_builder_append_buff(sb, NYX_SB_NO_ESCAPE, k.len - 3, k.buf + 2);
+            nyx_string_builder_append(sb, NYX_SB_NO_ESCAPE, "=\"");
+            nyx_string_builder_append(sb, NYX_SB_ESCAPE_XML, val);
+            nyx_string_builder_append(sb, NYX_SB_NO_ESCAPE, "\"");
 
             nyx_memory_free(val);
         }
@@ -160,28 +420,37 @@ static void j2x_emit_element(nyx_string_builder_t *out, struct mg_str obj)
 
     if(has_txt || has_kids)
     {
-        nyx_string_builder_append(out, NYX_SB_NO_ESCAPE, ">");
+        nyx_string_builder_append(sb, NYX_SB_NO_ESCAPE, ">");
 
         if(has_txt)
         {
-            str_t txt = dup_json_string(txt_str);
-            nyx_string_builder_append(out, NYX_SB_ESCAPE_XML, txt);
-            nyx_memory_free(txt);
+            if(ctx->stream_threshold > 0 && txt_str.len >= ctx->stream_threshold && txt_str.buf[0] == '"')
+            {
+                flush_builder(ctx, meta, sb);
+
+                stream_json_string(ctx, meta, txt_str);
+            }
+            else
+            {
+                str_t txt = dup_json_string(txt_str);
+                nyx_string_builder_append(sb, NYX_SB_ESCAPE_XML, txt);
+                nyx_memory_free(txt);
+            }
         }
 
         if(has_kids)
         {
             for(size_t offset = 0; (offset = mg_json_next(kids_str, offset, &k, &v)) != 0;)
             {
-                j2x_emit_element(out, v);
+                j2x_emit_element(ctx, meta, sb, v);
             }
         }
 
-        nyx_string_builder_append(out, NYX_SB_NO_ESCAPE, "</", tag, ">");
+        nyx_string_builder_append(sb, NYX_SB_NO_ESCAPE, "</", tag, ">");
     }
     else
     {
-        nyx_string_builder_append(out, NYX_SB_NO_ESCAPE, "/>");
+        nyx_string_builder_append(sb, NYX_SB_NO_ESCAPE, "/>");
     }
 
     /*----------------------------------------------------------------------------------------------------------------*/
@@ -213,21 +482,69 @@ void nyx_j2x_close(nyx_j2x_ctx_t *ctx)
     nyx_memory_free(ctx);
 }
 
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* ABOVE THE THRESHOLD, TEXT CONTENTS (E.G. BLOB PAYLOADS) ARE STREAMED: emit_fn THEN RECEIVES THE MESSAGE AS SEVERAL */
+/* CONSECUTIVE FRAGMENTS, NOT NUL-TERMINATED, SHARING THE SAME METADATA                                               */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_j2x_set_stream_threshold(nyx_j2x_ctx_t *ctx, size_t stream_threshold)
+{
+    ctx->stream_threshold = stream_threshold;
+}
+
 /*--------------------------------------------------------------------------------------------------------------------*/
 
 void nyx_j2x_feed(const nyx_j2x_ctx_t *ctx, size_t len, STR_t text)
 {
     if(ctx->emit_fn != NULL && len > 0x00 && text != NULL)
     {
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        struct mg_str obj = mg_str_n(text, len);
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        struct mg_str k;
+        struct mg_str v;
+
+        str_t tag = NULL;
+        str_t device = NULL;
+        str_t name = NULL;
+
+        for(size_t offset = 0; (offset = mg_json_next(obj, offset, &k, &v)) != 0;)
+        {
+            /*--*/ if(tag == NULL && key_eq(k, /*-*/"<>"/*-*/)) {
+                tag = dup_json_string(v);
+            } else if(device == NULL && key_eq(k, "@device")) {
+                device = dup_json_string(v);
+            } else if(name == NULL && key_eq(k, /**/"@name"/**/)) {
+                name = dup_json_string(v);
+            }
+        }
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        const nyx_meta_t meta = {
+            .tag = tag,
+            .device = device,
+            .name = name,
+        };
+
         nyx_string_builder_t *sb = nyx_string_builder_new();
 
-        j2x_emit_element(sb, mg_str_n(text, len));
+        j2x_emit_element(ctx, &meta, sb, obj);
 
-        str_t xml = nyx_string_builder_to_string(sb);
-        ctx->emit_fn(strlen(xml), xml);
-        nyx_memory_free(xml);
+        flush_builder(ctx, &meta, sb);
 
         nyx_string_builder_free(sb);
+
+        /*------------------------------------------------------------------------------------------------------------*/
+
+        nyx_memory_free(tag);
+        nyx_memory_free(device);
+        nyx_memory_free(name);
+
+        /*------------------------------------------------------------------------------------------------------------*/
     }
 }
 
@@ -6,12 +6,22 @@
 /*--------------------------------------------------------------------------------------------------------------------*/
 
 #include <ctype.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <libxml/SAX2.h>
 
 #include "bridge.h"
 
+#include "external/mongoose.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define MAX_ATTACHED_FDS 64
+
 /*--------------------------------------------------------------------------------------------------------------------*/
 
 struct nyx_x2j_ctx_s
@@ -36,13 +46,208 @@ struct nyx_x2j_ctx_s
 
     nyx_x2j_emit_fn emit_fn;
 
+    nyx_x2j_blob_fn blob_fn;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    char tag[64];
+    char device[64];
+    char name[64];
+    char state[16];
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    int fds[MAX_ATTACHED_FDS];
+
+    size_t fd_head;
+
+    size_t fd_cnt;
+
+    bool in_blob;
+
+    char blob_name[64];
+
+    int blob_fd;
+
+    size_t blob_len;
+
     /*----------------------------------------------------------------------------------------------------------------*/
 };
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-static void sax_start(void *ud, const xmlChar *name, const xmlChar **atts)
+static void copy_name(str_t dst, size_t size, STR_t src, size_t len)
+{
+    if(len > size - 1)
+    {
+        len = size - 1;
+    }
+
+    memcpy(dst, src, len);
+
+    dst[len] = '\0';
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static size_t parse_size(STR_t src, size_t len)
+{
+    char buff[32];
+
+    copy_name(buff, sizeof(buff), src, len);
+
+    return (size_t) strtoull(buff, NULL, 10);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static int pop_fd(nyx_x2j_ctx_t *x2j_ctx)
+{
+    if(x2j_ctx->fd_cnt == 0)
+    {
+        return -1;
+    }
+
+    int result = x2j_ctx->fds[x2j_ctx->fd_head];
+
+    x2j_ctx->fd_head = (x2j_ctx->fd_head + 1) % MAX_ATTACHED_FDS;
+
+    x2j_ctx->fd_cnt--;
+
+    return result;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool append_blob_ref(nyx_x2j_ctx_t *x2j_ctx, size_t len, BUFF_t data)
 {
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(x2j_ctx->blob_fn == NULL)
+    {
+        return false;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    const nyx_meta_t meta = {
+        .tag = x2j_ctx->tag,
+        .device = x2j_ctx->device,
+        .name = x2j_ctx->name,
+    };
+
+    STR_t ref = x2j_ctx->blob_fn(&meta, x2j_ctx->blob_name, len, data);
+
+    if(ref == NULL)
+    {
+        return false;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    char crc32[16];
+
+    snprintf(crc32, sizeof(crc32), "%08x", mg_crc32(0, (STR_t) data, len));
+
+    nyx_string_builder_append(x2j_ctx->sb, NYX_SB_NO_ESCAPE, ",\"@crc32\":\"", crc32, "\",\"@ref\":\"");
+    nyx_string_builder_append(x2j_ctx->sb, NYX_SB_ESCAPE_JSON, ref);
+    nyx_string_builder_append(x2j_ctx->sb, NYX_SB_NO_ESCAPE, "\"");
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void append_inline_blob(nyx_x2j_ctx_t *x2j_ctx, STR_t txt)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(x2j_ctx->blob_fn != NULL)
+    {
+        size_t len = strlen(txt);
+
+        buff_t data = nyx_memory_alloc(NYX_BASE64_DECODED_SIZE(len));
+
+        bool published = append_blob_ref(x2j_ctx, nyx_base64_decode(data, len, txt), data);
+
+        nyx_memory_free(data);
+
+        if(published)
+        {
+            return;
+        }
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_string_builder_append(x2j_ctx->sb, NYX_SB_NO_ESCAPE, ",\"$\":\"");
+    nyx_string_builder_append(x2j_ctx->sb, NYX_SB_ESCAPE_JSON, txt);
+    nyx_string_builder_append(x2j_ctx->sb, NYX_SB_NO_ESCAPE, "\"");
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void append_attached_blob(nyx_x2j_ctx_t *x2j_ctx)
+{
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    int fd = x2j_ctx->blob_fd;
+
+    size_t len = x2j_ctx->blob_len;
+
+    x2j_ctx->blob_fd = -1;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    struct stat st;
+
+    if(fstat(fd, &st) == 0 && (size_t) st.st_size < len)
+    {
+        len = (size_t) st.st_size;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    BUFF_t data = len > 0 ? mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+
+    if(data != MAP_FAILED)
+    {
+        if(!append_blob_ref(x2j_ctx, len, data))
+        {
+            nyx_string_builder_append(x2j_ctx->sb, NYX_SB_NO_ESCAPE, ",\"$\":\"");
+
+            nyx_base64_encode(nyx_string_builder_reserve(x2j_ctx->sb, NYX_SB_NO_ESCAPE, NYX_BASE64_ENCODED_SIZE(len)), len, data);
+
+            nyx_string_builder_append(x2j_ctx->sb, NYX_SB_NO_ESCAPE, "\"");
+        }
+
+        munmap((buff_t) data, len);
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    close(fd);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static void sax_start(
+    void *ud,
+    const xmlChar *name,
+    __attribute__ ((unused)) const xmlChar *prefix,
+    __attribute__ ((unused)) const xmlChar *uri,
+    __attribute__ ((unused)) int nb_namespaces,
+    __attribute__ ((unused)) const xmlChar **namespaces,
+    int nb_attributes,
+    __attribute__ ((unused)) int nb_defaulted,
+    const xmlChar **atts
+) {
     nyx_x2j_ctx_t *x2j_ctx = ud;
 
     /*----------------------------------------------------------------------------------------------------------------*/
@@ -55,10 +260,20 @@ static void sax_start(void *ud, const xmlChar *name, const xmlChar **atts)
     {
         nyx_string_builder_clear(x2j_ctx->sb);
 
+        copy_name(x2j_ctx->tag, sizeof(x2j_ctx->tag), (STR_t) name, strlen((STR_t) name));
+
+        x2j_ctx->device[0] = '\0';
+        x2j_ctx->name[0] = '\0';
+        x2j_ctx->state[0] = '\0';
+
         x2j_ctx->children_cnt = 0;
     }
     else if(d == 2)
     {
+        x2j_ctx->in_blob = strcmp((STR_t) name, "oneBLOB") == 0;
+
+        x2j_ctx->blob_name[0] = '\0';
+
         if(x2j_ctx->children_cnt == 0)
         {
             nyx_string_builder_append(x2j_ctx->sb, NYX_SB_NO_ESCAPE, ",\"children\":[");
@@ -79,20 +294,74 @@ static void sax_start(void *ud, const xmlChar *name, const xmlChar **atts)
     nyx_string_builder_append(x2j_ctx->sb, NYX_SB_ESCAPE_JSON, (STR_t) name);
     nyx_string_builder_append(x2j_ctx->sb, NYX_SB_NO_ESCAPE, "\",\"@client\":\"INDI\"");
 
+    bool attached = false;
+
+    size_t blob_len = 0;
+
     if(atts != NULL)
     {
-        for(int i = 0; atts[i + 0] != NULL && atts[i + 1] != NULL; i += 2)
+        for(int i = 0; i < 5 * nb_attributes; i += 5)
         {
+            /*--------------------------------------------------------------------------------------------------------*/
+            /* SHARED BLOBS: THE PAYLOAD COMES AS A FILE DESCRIPTOR ATTACHED TO THE UNIX SOCKET                       */
+            /*--------------------------------------------------------------------------------------------------------*/
+
+            if(d == 2)
+            {
+                /**/ if(strcmp((STR_t) atts[i + 0], "attached") == 0)
+                {
+                    attached = atts[i + 4] - atts[i + 3] == 4 && strncmp((STR_t) atts[i + 3], "true", 4) == 0;
+
+                    continue;
+                }
+                else if(strcmp((STR_t) atts[i + 0], "size") == 0 && blob_len == 0)
+                {
+                    blob_len = parse_size((STR_t) atts[i + 3], (size_t) (atts[i + 4] - atts[i + 3]));
+                }
+                else if(strcmp((STR_t) atts[i + 0], "len") == 0)
+                {
+                    blob_len = parse_size((STR_t) atts[i + 3], (size_t) (atts[i + 4] - atts[i + 3]));
+                }
+                else if(strcmp((STR_t) atts[i + 0], "name") == 0)
+                {
+                    copy_name(x2j_ctx->blob_name, sizeof(x2j_ctx->blob_name), (STR_t) atts[i + 3], (size_t) (atts[i + 4] - atts[i + 3]));
+                }
+            }
+
+            /*--------------------------------------------------------------------------------------------------------*/
+
             nyx_string_builder_append(x2j_ctx->sb, NYX_SB_NO_ESCAPE, ",\"@");
             nyx_string_builder_append(x2j_ctx->sb, NYX_SB_ESCAPE_JSON, (STR_t) atts[i + 0]);
             nyx_string_builder_append(x2j_ctx->sb, NYX_SB_NO_ESCAPE, "\":\"");
-            nyx_string_builder_append(x2j_ctx->sb, NYX_SB_ESCAPE_JSON, (STR_t) atts[i + 1]);
+            nyx_string_builder_append_buff(x2j_ctx->sb, NYX_SB_ESCAPE_JSON, (size_t) (atts[i + 4] - atts[i + 3]), (STR_t) atts[i + 3]);
             nyx_string_builder_append(x2j_ctx->sb, NYX_SB_NO_ESCAPE, "\"");
+
+            if(d == 1)
+            {
+                /**/ if(strcmp((STR_t) atts[i + 0], "device") == 0) {
+                    copy_name(x2j_ctx->device, sizeof(x2j_ctx->device), (STR_t) atts[i + 3], (size_t) (atts[i + 4] - atts[i + 3]));
+                }
+                else if(strcmp((STR_t) atts[i + 0], /**/"name"/**/) == 0) {
+                    copy_name(x2j_ctx->name, sizeof(x2j_ctx->name), (STR_t) atts[i + 3], (size_t) (atts[i + 4] - atts[i + 3]));
+                }
+                else if(strcmp((STR_t) atts[i + 0], /*-*/"state"/*-*/) == 0) {
+                    copy_name(x2j_ctx->state, sizeof(x2j_ctx->state), (STR_t) atts[i + 3], (size_t) (atts[i + 4] - atts[i + 3]));
+                }
+            }
         }
     }
 
     /*----------------------------------------------------------------------------------------------------------------*/
 
+    if(attached)
+    {
+        x2j_ctx->blob_fd = pop_fd(x2j_ctx);
+
+        x2j_ctx->blob_len = blob_len;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
 __skip:
     nyx_string_builder_clear(x2j_ctx->txt_sb);
 
@@ -103,8 +372,12 @@ __skip:
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 
-static void sax_end(void *ud, __attribute__ ((unused)) const xmlChar *name)
-{
+static void sax_end(
+    void *ud,
+    __attribute__ ((unused)) const xmlChar *name,
+    __attribute__ ((unused)) const xmlChar *prefix,
+    __attribute__ ((unused)) const xmlChar *uri
+) {
     nyx_x2j_ctx_t *x2j_ctx = ud;
 
     /*----------------------------------------------------------------------------------------------------------------*/
@@ -126,9 +399,16 @@ static void sax_end(void *ud, __attribute__ ((unused)) const xmlChar *name)
     {
         str_t txt = nyx_string_builder_to_string(x2j_ctx->txt_sb);
 
-        nyx_string_builder_append(x2j_ctx->sb, NYX_SB_NO_ESCAPE, ",\"$\":\"");
-        nyx_string_builder_append(x2j_ctx->sb, NYX_SB_ESCAPE_JSON, txt);
-        nyx_string_builder_append(x2j_ctx->sb, NYX_SB_NO_ESCAPE, "\"");
+        if(x2j_ctx->in_blob && d == 2)
+        {
+            append_inline_blob(x2j_ctx, txt);
+        }
+        else
+        {
+            nyx_string_builder_append(x2j_ctx->sb, NYX_SB_NO_ESCAPE, ",\"$\":\"");
+            nyx_string_builder_append(x2j_ctx->sb, NYX_SB_ESCAPE_JSON, txt);
+            nyx_string_builder_append(x2j_ctx->sb, NYX_SB_NO_ESCAPE, "\"");
+        }
 
         nyx_string_builder_clear(x2j_ctx->txt_sb);
 
@@ -136,6 +416,10 @@ static void sax_end(void *ud, __attribute__ ((unused)) const xmlChar *name)
 
         nyx_memory_free(txt);
     }
+    else if(x2j_ctx->blob_fd >= 0 && d == 2)
+    {
+        append_attached_blob(x2j_ctx);
+    }
 
     /*----------------------------------------------------------------------------------------------------------------*/
 
@@ -154,8 +438,15 @@ static void sax_end(void *ud, __attribute__ ((unused)) const xmlChar *name)
 
         if(x2j_ctx->emit_fn != NULL)
         {
+            const nyx_meta_t meta = {
+                .tag = x2j_ctx->tag,
+                .device = x2j_ctx->device,
+                .name = x2j_ctx->name,
+                .state = x2j_ctx->state,
+            };
+
             str_t out = nyx_string_builder_to_string(x2j_ctx->sb);
-            x2j_ctx->emit_fn(strlen(out), out);
+            x2j_ctx->emit_fn(strlen(out), out, &meta);
             nyx_memory_free(out);
         }
     }
@@ -163,6 +454,8 @@ static void sax_end(void *ud, __attribute__ ((unused)) const xmlChar *name)
     {
         nyx_string_builder_append(x2j_ctx->sb, NYX_SB_NO_ESCAPE, "}");
 
+        x2j_ctx->in_blob = false;
+
         x2j_ctx->children_cnt++;
     }
 
@@ -184,15 +477,15 @@ static void sax_txt(void *ud, const xmlChar *str, int len)
 
     /*----------------------------------------------------------------------------------------------------------------*/
 
-    str_t s = (str_t) /* NOSONAR */ str + 0x00000;
-    str_t e = (str_t) /* NOSONAR */ str + len - 1;
+    STR_t s = (STR_t) str + 0x00000;
+    STR_t e = (STR_t) str + len - 1;
 
-    while(s <= e && isspace((unsigned char) *s)) { *s = '\0'; s++; }
-    while(e >= s && isspace((unsigned char) *e)) { *e = '\0'; e--; }
+    while(s <= e && isspace((unsigned char) *s)) { s++; }
+    while(e >= s && isspace((unsigned char) *e)) { e--; }
 
     if(s <= e)
     {
-        nyx_string_builder_append(p->txt_sb, NYX_SB_ESCAPE_JSON, s);
+        nyx_string_builder_append_buff(p->txt_sb, NYX_SB_NO_ESCAPE, (size_t) (e - s + 1), s);
 
         p->has_text = true;
     }
@@ -203,10 +496,10 @@ static void sax_txt(void *ud, const xmlChar *str, int len)
 /*--------------------------------------------------------------------------------------------------------------------*/
 
 static xmlSAXHandler sax = {
-    .initialized  = XML_SAX2_MAGIC,
-    .startElement = sax_start,
-    .endElement   = sax_end,
-    .characters   = sax_txt,
+    .initialized    = XML_SAX2_MAGIC,
+    .startElementNs = sax_start,
+    .endElementNs   = sax_end,
+    .characters     = sax_txt,
 };
 
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -227,7 +520,7 @@ nyx_x2j_ctx_t *nyx_x2j_init(nyx_x2j_emit_fn emit_fn)
 
     if(result->sax_ctx != NULL)
     {
-        xmlCtxtUseOptions(result->sax_ctx, XML_PARSE_RECOVER | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+        xmlCtxtUseOptions(result->sax_ctx, XML_PARSE_RECOVER | XML_PARSE_NOENT | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
     }
     else
     {
@@ -240,6 +533,8 @@ nyx_x2j_ctx_t *nyx_x2j_init(nyx_x2j_emit_fn emit_fn)
 
     result->emit_fn = emit_fn;
 
+    result->blob_fd = -1;
+
     result->sb = nyx_string_builder_new();
 
     result->txt_sb = nyx_string_builder_new();
@@ -261,6 +556,12 @@ void nyx_x2j_close(nyx_x2j_ctx_t *ctx)
 
     xmlFreeParserCtxt(ctx->sax_ctx);
 
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    nyx_x2j_reset_fds(ctx);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
     nyx_string_builder_free(ctx->sb);
 
     nyx_string_builder_free(ctx->txt_sb);
@@ -281,3 +582,45 @@ void nyx_x2j_feed(const nyx_x2j_ctx_t *ctx, size_t len, STR_t text)
 }
 
 /*--------------------------------------------------------------------------------------------------------------------*/
+
+bool nyx_x2j_push_fd(nyx_x2j_ctx_t *ctx, int fd)
+{
+    if(ctx->fd_cnt < MAX_ATTACHED_FDS)
+    {
+        ctx->fds[(ctx->fd_head + ctx->fd_cnt++) % MAX_ATTACHED_FDS] = fd;
+
+        return true;
+    }
+    else
+    {
+        close(fd);
+
+        return false;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_x2j_reset_fds(nyx_x2j_ctx_t *ctx)
+{
+    for(int fd; (fd = pop_fd(ctx)) >= 0;)
+    {
+        close(fd);
+    }
+
+    if(ctx->blob_fd >= 0)
+    {
+        close(ctx->blob_fd);
+
+        ctx->blob_fd = -1;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_x2j_set_blob_fn(nyx_x2j_ctx_t *ctx, nyx_x2j_blob_fn blob_fn)
+{
+    ctx->blob_fn = blob_fn;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,192 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <string.h>
+#include <pthread.h>
+
+#include "bridge.h"
+
+#include "external/mongoose.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static STR_t HANDLER_NAMES[NYX_WATCHDOG_HANDLERS] = {
+    [NYX_WATCHDOG_INDI] = "indi",
+    [NYX_WATCHDOG_MQTT] = "mqtt",
+    [NYX_WATCHDOG_MQTT_BULK] = "mqtt_bulk",
+    [NYX_WATCHDOG_HTTP] = "http",
+    [NYX_WATCHDOG_PING] = "ping_timer",
+    [NYX_WATCHDOG_STATS] = "stats_timer",
+    [NYX_WATCHDOG_RETRY] = "retry_timer",
+    [NYX_WATCHDOG_BROKER] = "broker",
+    [NYX_WATCHDOG_SPOOL] = "spool_timer",
+};
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static uint64_t m_budget = 0;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static nyx_watchdog_t m_live = {0};
+
+static nyx_watchdog_t m_snapshot = {0};
+
+static nyx_watchdog_t m_cumulative = {0};
+
+static pthread_mutex_t m_snapshot_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* CURRENT ITERATION, THE FIRST CALLBACK MARKS THE END OF THE IDLE WAIT                                               */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static uint64_t m_work_start = 0;
+
+static uint64_t m_worst = 0;
+
+static int m_worst_handler = -1;
+
+static size_t m_worst_len = 0;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_watchdog_init(uint64_t budget)
+{
+    m_budget = budget;
+
+    m_work_start = 0;
+
+    m_worst_handler = -1;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+STR_t nyx_watchdog_handler_name(int handler)
+{
+    return (handler >= 0 && handler < NYX_WATCHDOG_HANDLERS) ? HANDLER_NAMES[handler] : "poll";
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+uint64_t nyx_watchdog_enter(void)
+{
+    uint64_t now = nyx_metrics_now();
+
+    if(m_work_start == 0)
+    {
+        m_work_start = now;
+    }
+
+    return now;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_watchdog_leave(int handler, size_t len, uint64_t start)
+{
+    uint64_t now = nyx_metrics_now();
+
+    uint64_t value = now > start ? now - start : 0;
+
+    nyx_hist_record(&m_live.handler[handler], value);
+
+    nyx_hist_record(&m_cumulative.handler[handler], value);
+
+    if(m_worst_handler < 0 || m_worst < value)
+    {
+        m_worst = value;
+        m_worst_handler = handler;
+        m_worst_len = len;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_watchdog_iteration(void)
+{
+    if(m_work_start == 0)
+    {
+        return;
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    uint64_t now = nyx_metrics_now();
+
+    uint64_t value = now > m_work_start ? now - m_work_start : 0;
+
+    nyx_hist_record(&m_live.iteration, value);
+
+    nyx_hist_record(&m_cumulative.iteration, value);
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    if(m_budget > 0 && value > m_budget)
+    {
+        m_cumulative.stalls++;
+        m_cumulative.last_stall = value;
+        m_cumulative.last_stall_handler = m_worst_handler;
+        m_cumulative.last_stall_len = m_worst_len;
+
+        pthread_mutex_lock(&m_snapshot_mutex);
+
+        m_snapshot.stalls = m_cumulative.stalls;
+        m_snapshot.last_stall = m_cumulative.last_stall;
+        m_snapshot.last_stall_handler = m_cumulative.last_stall_handler;
+        m_snapshot.last_stall_len = m_cumulative.last_stall_len;
+
+        pthread_mutex_unlock(&m_snapshot_mutex);
+
+        MG_ERROR(("Event loop stalled for %lu ms, %s handler took %lu ms on %lu bytes",
+            (unsigned long) (value / 1000),
+            nyx_watchdog_handler_name(m_worst_handler),
+            (unsigned long) (m_worst / 1000),
+            (unsigned long) m_worst_len
+        ));
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    m_work_start = 0;
+
+    m_worst_handler = -1;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_watchdog_rotate(void)
+{
+    pthread_mutex_lock(&m_snapshot_mutex);
+
+    memcpy(&m_snapshot.iteration, &m_live.iteration, sizeof(nyx_hist_t));
+
+    memcpy(m_snapshot.handler, m_live.handler, sizeof(m_live.handler));
+
+    pthread_mutex_unlock(&m_snapshot_mutex);
+
+    memset(&m_live, 0x00, sizeof(nyx_watchdog_t));
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_watchdog_snapshot(nyx_watchdog_t *result)
+{
+    pthread_mutex_lock(&m_snapshot_mutex);
+
+    memcpy(result, &m_snapshot, sizeof(nyx_watchdog_t));
+
+    pthread_mutex_unlock(&m_snapshot_mutex);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+const nyx_watchdog_t *nyx_watchdog_cumulative(void)
+{
+    return &m_cumulative;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
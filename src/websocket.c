@@ -0,0 +1,184 @@
+/* INDI-Nyx Driver
+ * Author: Jérôme ODIER <jerome.odier@lpsc.in2p3.fr>
+ * SPDX-License-Identifier: GPL-2.0-only
+ */
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "external/mongoose.h"
+
+#include "bridge.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+#define FILTER_SIZE 256
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+typedef struct client_s
+{
+    struct mg_connection *connection;
+
+    char devices[FILTER_SIZE];
+    char properties[FILTER_SIZE];
+    char tags[FILTER_SIZE];
+
+    uint64_t dropped;
+
+    struct client_s *next;
+
+} client_t;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static client_t *m_clients = NULL;
+
+static size_t m_client_cnt = 0;
+
+static size_t m_queue_limit = 1024UL * 1024UL;
+
+static uint64_t m_dropped = 0;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* FILTER = COMMA-SEPARATED GLOBS ('*', '?'), AN EMPTY FILTER MATCHES EVERYTHING                                      */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static bool filter_match(STR_t filter, STR_t value)
+{
+    if(filter[0] == '\0')
+    {
+        return true;
+    }
+
+    if(value == NULL)
+    {
+        value = "";
+    }
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    struct mg_str item, rest = mg_str(filter);
+
+    while(mg_span(rest, &item, &rest, ','))
+    {
+        if(item.len > 0 && mg_match(mg_str(value), item, NULL))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_ws_init(size_t queue_limit)
+{
+    m_queue_limit = queue_limit;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_ws_open(struct mg_connection *connection, size_t query_len, STR_t query)
+{
+    client_t *client = nyx_memory_alloc(sizeof(client_t));
+
+    memset(client, 0x00, sizeof(client_t));
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    const struct mg_str str = mg_str_n(query, query_len);
+
+    mg_http_get_var(&str, "device", client->devices, sizeof(client->devices));
+    mg_http_get_var(&str, "property", client->properties, sizeof(client->properties));
+    mg_http_get_var(&str, "tag", client->tags, sizeof(client->tags));
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    client->connection = connection;
+
+    client->next = m_clients;
+
+    m_clients = client;
+
+    m_client_cnt++;
+
+    /*----------------------------------------------------------------------------------------------------------------*/
+
+    MG_INFO(("%lu WS OPEN (device=`%s`, property=`%s`, tag=`%s`)", connection->id, client->devices, client->properties, client->tags));
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_ws_close(struct mg_connection *connection)
+{
+    for(client_t **pp = &m_clients; *pp != NULL; pp = &(*pp)->next)
+    {
+        client_t *client = *pp;
+
+        if(client->connection == connection)
+        {
+            MG_INFO(("%lu WS CLOSE (%lu messages dropped)", connection->id, (unsigned long) client->dropped));
+
+            *pp = client->next;
+
+            m_client_cnt--;
+
+            nyx_memory_free(client);
+
+            break;
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+void nyx_ws_publish(const nyx_meta_t *meta, size_t len, STR_t json)
+{
+    for(client_t *client = m_clients; client != NULL; client = client->next)
+    {
+        if(filter_match(client->devices, meta->device)
+           &&
+           filter_match(client->properties, meta->name)
+           &&
+           filter_match(client->tags, meta->tag)
+        ) {
+            /*--------------------------------------------------------------------------------------------------------*/
+            /* A BROWSER THAT DOES NOT READ FAST ENOUGH LOSES MESSAGES, THE BRIDGE NEVER WAITS FOR IT                 */
+            /*--------------------------------------------------------------------------------------------------------*/
+
+            if(client->connection->send.len > 0 && client->connection->send.len + len > m_queue_limit)
+            {
+                client->dropped++;
+
+                m_dropped++;
+
+                continue;
+            }
+
+            /*--------------------------------------------------------------------------------------------------------*/
+
+            mg_ws_send(client->connection, json, len, WEBSOCKET_OP_TEXT);
+
+            /*--------------------------------------------------------------------------------------------------------*/
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+size_t nyx_ws_clients(void)
+{
+    return m_client_cnt;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+uint64_t nyx_ws_dropped(void)
+{
+    return m_dropped;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/